@@ -1,15 +1,31 @@
 #include "devices/input.h"
 #include <debug.h>
-#include "devices/intq.h"
+#include <ring.h>
 #include "devices/serial.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
 
-/* Stores keys from the keyboard and serial port. */
-static struct intq buffer;
+/* Input buffer size, in bytes.  Must be a power of 2. */
+#define INPUT_BUFSIZE 64
+
+/* Stores keys from the keyboard and serial port.  Keys are added
+   by interrupt handlers and removed by kernel threads; the ring
+   lets both sides run without excluding each other. */
+static struct ring buffer;
+static uint8_t buffer_data[INPUT_BUFSIZE];
+
+/* Only one thread may remove keys at once. */
+static struct lock reader_lock;
+
+/* Thread waiting for a key, if any. */
+static struct thread *waiter;
 
 /* Initializes the input buffer. */
 void
 input_init (void) {
-	intq_init (&buffer);
+	ring_init (&buffer, buffer_data, sizeof buffer_data);
+	lock_init (&reader_lock);
 }
 
 /* Adds a key to the input buffer.
@@ -17,9 +33,13 @@ input_init (void) {
 void
 input_putc (uint8_t key) {
 	ASSERT (intr_get_level () == INTR_OFF);
-	ASSERT (!intq_full (&buffer));
+	ASSERT (!ring_full (&buffer));
 
-	intq_putc (&buffer, key);
+	ring_putc (&buffer, key);
+	if (waiter != NULL) {
+		thread_unblock (waiter);
+		waiter = NULL;
+	}
 	serial_notify ();
 }
 
@@ -28,10 +48,24 @@ input_putc (uint8_t key) {
 uint8_t
 input_getc (void) {
 	enum intr_level old_level;
-	uint8_t key;
+	int key;
 
+	lock_acquire (&reader_lock);
+	while ((key = ring_getc (&buffer)) < 0) {
+		/* Recheck with interrupts off, so that a key added just
+		   now cannot slip in before we block. */
+		old_level = intr_disable ();
+		if (ring_empty (&buffer)) {
+			waiter = thread_current ();
+			thread_block ();
+		}
+		intr_set_level (old_level);
+	}
+	lock_release (&reader_lock);
+
+	/* There is room in the buffer again, so the serial port may
+	   resume receiving. */
 	old_level = intr_disable ();
-	key = intq_getc (&buffer);
 	serial_notify ();
 	intr_set_level (old_level);
 
@@ -39,10 +73,8 @@ input_getc (void) {
 }
 
 /* Returns true if the input buffer is full,
-   false otherwise.
-   Interrupts must be off. */
+   false otherwise. */
 bool
 input_full (void) {
-	ASSERT (intr_get_level () == INTR_OFF);
-	return intq_full (&buffer);
+	return ring_full (&buffer);
 }
@@ -0,0 +1,184 @@
+#include "devices/pmu.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+/* Driver for the Intel architectural performance monitoring
+   unit.  See [IA32-v3b] chapter 18, "Performance Monitoring".
+
+   Each general-purpose counter IA32_PMCx counts the event
+   selected by its IA32_PERFEVTSELx.  We program one counter per
+   enum pmc_counter, counting in both kernel and user mode, and
+   leave them free-running.  The counters are virtualized per
+   thread: pmu_switch(), called by schedule(), charges the events
+   since the outgoing thread was switched in to that thread and
+   notes where the incoming thread starts.
+
+   QEMU exposes the PMU under KVM (e.g. with -cpu host).  Without
+   it, CPUID reports no counters and every count reads as 0. */
+
+/* MSRs. */
+#define MSR_PERFEVTSEL0 0x186       /* First event select register. */
+#define MSR_PMC0 0x0c1              /* First counter. */
+#define MSR_PERF_GLOBAL_CTRL 0x38f  /* Global enable, version 2+. */
+
+/* IA32_PERFEVTSELx bits. */
+#define EVTSEL_USR (1 << 16)        /* Count in user mode. */
+#define EVTSEL_OS (1 << 17)         /* Count in kernel mode. */
+#define EVTSEL_EN (1 << 22)         /* Enable counter. */
+
+/* An event: event select and unit mask, plus the bit in CPUID
+   leaf 0xa's EBX that says it is unavailable, or -1 if it is not
+   an architectural event. */
+struct pmu_event {
+	uint8_t event;
+	uint8_t umask;
+	int unavailable_bit;
+};
+
+static const struct pmu_event events[PMC_CNT] = {
+	[PMC_CYCLES]       = { 0x3c, 0x00, 0 },
+	[PMC_INSTRUCTIONS] = { 0xc0, 0x00, 1 },
+	[PMC_LLC_MISSES]   = { 0x2e, 0x41, 4 },
+
+	/* DTLB_LOAD_MISSES.MISS_CAUSES_A_WALK.  Not architectural:
+	   this encoding holds from Nehalem through Skylake. */
+	[PMC_DTLB_MISSES]  = { 0x08, 0x01, -1 },
+};
+
+/* Number of counters programmed, 0 if there is no PMU. */
+static int counter_cnt;
+
+/* Mask of the bits each counter implements. */
+static uint64_t counter_mask;
+
+/* Events counted so far by threads that have been switched out,
+   for pmu_print_stats(). */
+static uint64_t totals[PMC_CNT];
+
+/* Executes CPUID with LEAF in EAX and stores the results. */
+static void
+cpuid (uint32_t leaf, uint32_t r[4]) {
+	asm volatile ("cpuid"
+			: "=a" (r[0]), "=b" (r[1]), "=c" (r[2]), "=d" (r[3])
+			: "a" (leaf), "c" (0));
+}
+
+/* Reads counter IDX. */
+static uint64_t
+read_pmc (int idx) {
+	uint32_t lo, hi;
+	asm volatile ("rdpmc" : "=a" (lo), "=d" (hi) : "c" (idx));
+	return ((uint64_t) hi << 32) | lo;
+}
+
+/* Detects the PMU and starts the counters, charging events from
+   now on to the running thread. */
+void
+pmu_init (void) {
+	uint32_t r[4];
+	char vendor[12];
+	int version, gp_cnt, width, i;
+
+	cpuid (0, r);
+	memcpy (vendor, &r[1], 4);
+	memcpy (vendor + 4, &r[3], 4);
+	memcpy (vendor + 8, &r[2], 4);
+	if (r[0] < 0xa || memcmp (vendor, "GenuineIntel", 12))
+		return;
+
+	cpuid (0xa, r);
+	version = r[0] & 0xff;
+	gp_cnt = (r[0] >> 8) & 0xff;
+	width = (r[0] >> 16) & 0xff;
+	if (version == 0 || gp_cnt == 0 || width == 0)
+		return;
+
+	counter_cnt = gp_cnt < PMC_CNT ? gp_cnt : PMC_CNT;
+	counter_mask = width >= 64 ? (uint64_t) -1 : ((uint64_t) 1 << width) - 1;
+	for (i = 0; i < counter_cnt; i++) {
+		const struct pmu_event *e = &events[i];
+		bool available = e->unavailable_bit < 0
+			|| (e->unavailable_bit < (int) ((r[0] >> 24) & 0xff)
+				&& !(r[1] & (1u << e->unavailable_bit)));
+
+		write_msr (MSR_PERFEVTSEL0 + i, 0);
+		write_msr (MSR_PMC0 + i, 0);
+		if (available)
+			write_msr (MSR_PERFEVTSEL0 + i, e->event | (e->umask << 8)
+					| EVTSEL_USR | EVTSEL_OS | EVTSEL_EN);
+	}
+	if (version >= 2)
+		write_msr (MSR_PERF_GLOBAL_CTRL, ((uint64_t) 1 << counter_cnt) - 1);
+
+	for (i = 0; i < counter_cnt; i++)
+		thread_current ()->pmu.start[i] = read_pmc (i);
+	printf ("pmu: %d counters, %d bits wide\n", counter_cnt, width);
+}
+
+/* Returns the number of counters running, which count the first
+   that many events of enum pmc_counter. */
+int
+pmu_counters (void) {
+	return counter_cnt;
+}
+
+/* Charges the events since PREV was switched in to PREV and
+   starts charging events to NEXT.  Interrupts must be off. */
+void
+pmu_switch (struct thread *prev, struct thread *next) {
+	int i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (i = 0; i < counter_cnt; i++) {
+		uint64_t now = read_pmc (i);
+		uint64_t delta = (now - prev->pmu.start[i]) & counter_mask;
+
+		prev->pmu.count[i] += delta;
+		totals[i] += delta;
+		next->pmu.start[i] = now;
+	}
+}
+
+/* Stores the events counted while the running thread ran into
+   COUNT.  Counters the machine does not have read as 0. */
+void
+pmu_read (uint64_t count[PMC_CNT]) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level = intr_disable ();
+	int i;
+
+	for (i = 0; i < PMC_CNT; i++) {
+		count[i] = t->pmu.count[i];
+		if (i < counter_cnt)
+			count[i] += (read_pmc (i) - t->pmu.start[i]) & counter_mask;
+	}
+	intr_set_level (old_level);
+}
+
+/* Prints PMU statistics. */
+void
+pmu_print_stats (void) {
+	uint64_t t[PMC_CNT];
+	int i;
+
+	if (counter_cnt == 0)
+		return;
+
+	/* Add in the running thread's current time slice. */
+	for (i = 0; i < PMC_CNT; i++) {
+		t[i] = totals[i];
+		if (i < counter_cnt)
+			t[i] += (read_pmc (i) - thread_current ()->pmu.start[i])
+				& counter_mask;
+	}
+	printf ("PMU: %llu cycles, %llu instructions, %llu LLC misses, "
+			"%llu DTLB misses\n",
+			t[PMC_CYCLES], t[PMC_INSTRUCTIONS],
+			t[PMC_LLC_MISSES], t[PMC_DTLB_MISSES]);
+}
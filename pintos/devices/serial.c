@@ -1,7 +1,7 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <ring.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -37,6 +37,15 @@
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable the transmit and receive FIFOs. */
+#define FCR_CLEAR_RECV 0x02     /* Discard bytes in the receive FIFO. */
+#define FCR_CLEAR_XMIT 0x04     /* Discard bytes in the transmit FIFO. */
+#define FCR_TRIGGER_1 0x00      /* Receive interrupt after 1 byte. */
+
+/* Size of the 16550A transmit FIFO, in bytes. */
+#define XMIT_FIFO_SIZE 16
+
 /* Line Control Register bits. */
 #define LCR_N81 0x03            /* No parity, 8 data bits, 1 stop bit. */
 #define LCR_DLAB 0x80           /* Divisor Latch Access Bit (DLAB). */
@@ -48,14 +57,44 @@
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
 #define LSR_THRE 0x20           /* THR Empty. */
 
+/* Default data rate, in bits per second.  115.2 kbps is the
+   fastest rate the 16550A's 1.8432 MHz clock can produce. */
+#ifndef SERIAL_BPS
+#define SERIAL_BPS 115200
+#endif
+
+/* Size of the transmit queue, in bytes.  Must be a power of 2.
+   Output beyond this makes writers wait for the UART. */
+#ifndef SERIAL_TXQ_SIZE
+#define SERIAL_TXQ_SIZE 4096
+#endif
+
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Data to be transmitted.  Threads produce into the ring, with
+   interrupts off to keep them from interleaving; the interrupt
+   handler consumes from it.  Once interrupt-driven I/O starts,
+   only the interrupt handler consumes, except when interrupts are
+   off and the queue must be drained by polling. */
+static struct ring txq;
+static uint8_t txq_data[SERIAL_TXQ_SIZE];
+
+/* Thread waiting for room in TXQ, if any.  Only one thread may
+   wait at once. */
+static struct lock txq_lock;
+static struct thread *txq_waiter;
+
+/* Number of bytes that may still be written to the transmit
+   FIFO without checking LSR_THRE again.  With the FIFO enabled,
+   THRE means the whole FIFO is empty, so each time it is seen
+   XMIT_FIFO_SIZE bytes can be written back to back. */
+static int xmit_room;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static bool xmit_ready (void);
+static void xmit_byte (uint8_t);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -67,10 +106,9 @@ static void
 init_poll (void) {
 	ASSERT (mode == UNINIT);
 	outb (IER_REG, 0);                    /* Turn off all interrupts. */
-	outb (FCR_REG, 0);                    /* Disable FIFO. */
-	set_serial (115200);                  /* 115.2 kbps, N-8-1. */
+	set_serial (SERIAL_BPS);              /* N-8-1, FIFOs enabled. */
 	outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-	intq_init (&txq);
+	ring_init (&txq, txq_data, sizeof txq_data);
 	mode = POLL;
 }
 
@@ -85,6 +123,7 @@ serial_init_queue (void) {
 		init_poll ();
 	ASSERT (mode == POLL);
 
+	lock_init (&txq_lock);
 	intr_register_ext (0x20 + 4, serial_interrupt, "serial");
 	mode = QUEUE;
 	old_level = intr_disable ();
@@ -95,27 +134,53 @@ serial_init_queue (void) {
 /* Sends BYTE to the serial port. */
 void
 serial_putc (uint8_t byte) {
+	serial_write (&byte, 1);
+}
+
+/* Sends the SIZE bytes in BUFFER to the serial port.  Interrupts
+   are disabled and the interrupt enable register is updated only
+   once for the whole buffer, rather than once per byte. */
+void
+serial_write (const void *buffer, size_t size) {
+	const uint8_t *p = buffer;
 	enum intr_level old_level = intr_disable ();
 
 	if (mode != QUEUE) {
 		/* If we're not set up for interrupt-driven I/O yet,
-		   use dumb polling to transmit a byte. */
+		   use dumb polling to transmit the bytes. */
 		if (mode == UNINIT)
 			init_poll ();
-		putc_poll (byte);
+		while (size-- > 0)
+			putc_poll (*p++);
 	} else {
-		/* Otherwise, queue a byte and update the interrupt enable
-		   register. */
-		if (old_level == INTR_OFF && intq_full (&txq)) {
-			/* Interrupts are off and the transmit queue is full.
-			   If we wanted to wait for the queue to empty,
-			   we'd have to reenable interrupts.
-			   That's impolite, so we'll send a character via
-			   polling instead. */
-			putc_poll (intq_getc (&txq));
+		/* Otherwise, queue as many bytes as fit at a time and
+		   update the interrupt enable register. */
+		for (;;) {
+			size_t n = ring_write (&txq, p, size);
+			p += n;
+			size -= n;
+			if (size == 0)
+				break;
+
+			if (old_level == INTR_OFF) {
+				/* Interrupts are off and the transmit queue is full.
+				   If we wanted to wait for the queue to empty,
+				   we'd have to reenable interrupts.
+				   That's impolite, so we'll send a character via
+				   polling instead. */
+				putc_poll (ring_getc (&txq));
+			} else {
+				/* Sleep until the interrupt handler drains the
+				   queue, making sure its interrupt is enabled. */
+				lock_acquire (&txq_lock);
+				if (ring_full (&txq)) {
+					txq_waiter = thread_current ();
+					write_ier ();
+					thread_block ();
+				}
+				lock_release (&txq_lock);
+			}
 		}
-
-		intq_putc (&txq, byte);
 		write_ier ();
 	}
 
@@ -127,8 +192,10 @@ serial_putc (uint8_t byte) {
 void
 serial_flush (void) {
 	enum intr_level old_level = intr_disable ();
-	while (!intq_empty (&txq))
-		putc_poll (intq_getc (&txq));
+	int byte;
+
+	while ((byte = ring_getc (&txq)) >= 0)
+		putc_poll (byte);
 	intr_set_level (old_level);
 }
 
@@ -160,6 +227,11 @@ set_serial (int bps) {
 
 	/* Reset DLAB. */
 	outb (LCR_REG, LCR_N81);
+
+	/* Enable and reset the FIFOs. */
+	outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RECV | FCR_CLEAR_XMIT
+			| FCR_TRIGGER_1);
+	xmit_room = 0;
 }
 
 /* Update interrupt enable register. */
@@ -171,7 +243,7 @@ write_ier (void) {
 
 	/* Enable transmit interrupt if we have any characters to
 	   transmit. */
-	if (!intq_empty (&txq))
+	if (!ring_empty (&txq))
 		ier |= IER_XMIT;
 
 	/* Enable receive interrupt if we have room to store any
@@ -188,9 +260,28 @@ static void
 putc_poll (uint8_t byte) {
 	ASSERT (intr_get_level () == INTR_OFF);
 
-	while ((inb (LSR_REG) & LSR_THRE) == 0)
+	while (!xmit_ready ())
 		continue;
+	xmit_byte (byte);
+}
+
+/* Returns true if the transmit FIFO has room for another byte. */
+static bool
+xmit_ready (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (xmit_room == 0 && (inb (LSR_REG) & LSR_THRE) != 0)
+		xmit_room = XMIT_FIFO_SIZE;
+	return xmit_room > 0;
+}
+
+/* Writes BYTE to the transmit FIFO, which must have room. */
+static void
+xmit_byte (uint8_t byte) {
+	ASSERT (xmit_room > 0);
+
 	outb (THR_REG, byte);
+	xmit_room--;
 }
 
 /* Serial interrupt handler. */
@@ -206,9 +297,16 @@ serial_interrupt (struct intr_frame *f UNUSED) {
 		input_putc (inb (RBR_REG));
 
 	/* As long as we have a byte to transmit, and the hardware is
-	   ready to accept a byte for transmission, transmit a byte. */
-	while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0)
-		outb (THR_REG, intq_getc (&txq));
+	   ready to accept a byte for transmission, transmit a byte.
+	   Each THRE interrupt refills the whole transmit FIFO. */
+	while (!ring_empty (&txq) && xmit_ready ())
+		xmit_byte (ring_getc (&txq));
+
+	/* Wake up a thread waiting for room in the queue. */
+	if (txq_waiter != NULL && !ring_full (&txq)) {
+		thread_unblock (txq_waiter);
+		txq_waiter = NULL;
+	}
 
 	/* Update interrupt enable register based on queue status. */
 	write_ier ();
@@ -5,8 +5,10 @@
 #include <stdio.h>
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 
 #if TIMER_FREQ < 19
 #error 8254 timer requires TIMER_FREQ >= 19
@@ -122,10 +124,12 @@ void timer_print_stats(void)
    printf("Timer: %" PRId64 " ticks\n", timer_ticks());
 }
 
-static void timer_interrupt(struct intr_frame *args UNUSED)
+static void timer_interrupt(struct intr_frame *args)
 {
    ticks++;
    thread_tick();
+   profile_sample(args);
+   workqueue_tick(ticks);
 
    if (list_empty(&sleep_list))
       return;
@@ -7,6 +7,7 @@
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
+static size_t free_map_hint;         /* Sector after the last allocation. */
 
 /* Initializes the free map. */
 void
@@ -24,15 +25,21 @@ free_map_init (void) {
  * available. */
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
-	disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+	/* Search from where the last allocation ended, so that a
+	   mostly full disk is not rescanned from the start each time. */
+	disk_sector_t sector = bitmap_scan_hint (free_map, free_map_hint, cnt, false);
+	if (sector != BITMAP_ERROR)
+		bitmap_set_multiple (free_map, sector, cnt, true);
 	if (sector != BITMAP_ERROR
 			&& free_map_file != NULL
 			&& !bitmap_write (free_map, free_map_file)) {
 		bitmap_set_multiple (free_map, sector, cnt, false);
 		sector = BITMAP_ERROR;
 	}
-	if (sector != BITMAP_ERROR)
+	if (sector != BITMAP_ERROR) {
 		*sectorp = sector;
+		free_map_hint = sector + cnt;
+	}
 	return sector != BITMAP_ERROR;
 }
 
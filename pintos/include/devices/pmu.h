@@ -0,0 +1,22 @@
+#ifndef DEVICES_PMU_H
+#define DEVICES_PMU_H
+
+#include <pmc.h>
+#include <stdint.h>
+
+/* Per-thread view of the performance counters.  Embedded in
+   struct thread and owned by devices/pmu.c. */
+struct pmu_counts {
+	uint64_t count[PMC_CNT];    /* Events while not running now. */
+	uint64_t start[PMC_CNT];    /* Counter values when switched in. */
+};
+
+struct thread;
+
+void pmu_init (void);
+int pmu_counters (void);
+void pmu_switch (struct thread *prev, struct thread *next);
+void pmu_read (uint64_t count[PMC_CNT]);
+void pmu_print_stats (void);
+
+#endif /* devices/pmu.h */
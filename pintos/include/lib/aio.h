@@ -0,0 +1,106 @@
+#ifndef __LIB_AIO_H
+#define __LIB_AIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Asynchronous I/O rings, shared between a process and the
+   kernel.  The process queues requests on the submission ring
+   and hands them to the kernel with io_enter(); the kernel posts
+   a completion on the completion ring as each one finishes, in
+   whatever order they finish.  A read's data and completion
+   arrive only during an io_enter() call, so wait for reads with
+   io_enter() rather than by polling the completion ring.
+
+   Each ring is a circular array indexed by free-running head and
+   tail counters.  The producer writes an entry and then advances
+   the tail; the consumer reads it and then advances the head.
+   The process produces submissions and consumes completions, and
+   the kernel the reverse. */
+
+/* Most entries in each ring. */
+#define IO_ENTRIES_MAX 64
+
+/* Most bytes one IO_READ or IO_WRITE transfers. */
+#define IO_LEN_MAX (64 * 1024)
+
+/* Most files open on a ring at once. */
+#define IO_FILES_MAX 16
+
+/* Request types. */
+enum io_opcode {
+	IO_NOP,                     /* Do nothing. */
+	IO_OPEN,                    /* Open file named ADDR; result is its fd. */
+	IO_CLOSE,                   /* Close FD. */
+	IO_READ,                    /* Read LEN bytes at OFF in FD into ADDR. */
+	IO_WRITE,                   /* Write LEN bytes from ADDR to FD at OFF. */
+	IO_FSYNC                    /* Wait for FD's writes to reach disk. */
+};
+
+/* Submission ring entry. */
+struct io_sqe {
+	uint8_t opcode;             /* enum io_opcode. */
+	uint8_t pad[3];
+	int32_t fd;                 /* File, as returned by IO_OPEN. */
+	uint64_t addr;              /* User buffer or file name. */
+	uint32_t len;               /* Bytes to transfer, IO_LEN_MAX at most. */
+	uint32_t off;               /* File offset. */
+	uint64_t user_data;         /* Copied to the completion. */
+};
+
+/* Completion ring entry. */
+struct io_cqe {
+	uint64_t user_data;         /* From the submission. */
+	int32_t res;                /* Result, or -1 on failure. */
+	uint32_t flags;
+};
+
+/* The rings, which fill one page mapped by io_setup(). */
+struct io_rings {
+	uint32_t sq_head;           /* Next submission the kernel takes. */
+	uint32_t sq_tail;           /* Next submission the process fills. */
+	uint32_t cq_head;           /* Next completion the process takes. */
+	uint32_t cq_tail;           /* Next completion the kernel fills. */
+	uint32_t entries;           /* Entries in each ring, a power of 2. */
+	uint32_t pad[3];
+	struct io_sqe sqes[IO_ENTRIES_MAX];
+	struct io_cqe cqes[IO_ENTRIES_MAX];
+};
+
+/* Returns the next free submission entry in R, or a null pointer
+   if the submission ring is full.  The entry is queued by
+   io_queue_sqe(). */
+static inline struct io_sqe *
+io_get_sqe (struct io_rings *r) {
+	uint32_t head = __atomic_load_n (&r->sq_head, __ATOMIC_ACQUIRE);
+
+	if (r->sq_tail - head >= r->entries)
+		return NULL;
+	return &r->sqes[r->sq_tail & (r->entries - 1)];
+}
+
+/* Queues the entry returned by io_get_sqe() for the next
+   io_enter(). */
+static inline void
+io_queue_sqe (struct io_rings *r) {
+	__atomic_store_n (&r->sq_tail, r->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+/* Returns the oldest completion in R, or a null pointer if there
+   is none.  The entry stays in the ring until io_cqe_seen(). */
+static inline struct io_cqe *
+io_peek_cqe (struct io_rings *r) {
+	uint32_t tail = __atomic_load_n (&r->cq_tail, __ATOMIC_ACQUIRE);
+
+	if (tail == r->cq_head)
+		return NULL;
+	return &r->cqes[r->cq_head & (r->entries - 1)];
+}
+
+/* Frees the completion returned by io_peek_cqe(). */
+static inline void
+io_cqe_seen (struct io_rings *r) {
+	__atomic_store_n (&r->cq_head, r->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+#endif /* lib/aio.h */
@@ -1,8 +1,43 @@
 #ifndef __LIB_KERNEL_CONSOLE_H
 #define __LIB_KERNEL_CONSOLE_H
 
+#include <stddef.h>
+
+/* Maximum number of bytes a thread buffers before its console
+   output is written out, even without a new-line. */
+#define CONSOLE_LINE_MAX 128
+
+/* Console output written by a thread that has not been flushed
+   yet.  Embedded in struct thread and owned by console.c. */
+struct console_line {
+	size_t len;                     /* Number of bytes in BUF. */
+	char buf[CONSOLE_LINE_MAX];     /* Pending output. */
+};
+
+/* Log levels, from most to least severe.  A line of console
+   output may begin with one of the KERN_* prefixes, e.g.
+   printf (KERN_DEBUG "x = %d\n", x), to set its level; other
+   lines are logged at LOG_DEFAULT.  Lines whose level is not
+   below the console log level are kept in the log but not
+   written to the console. */
+#define LOG_ERR 3
+#define LOG_WARNING 4
+#define LOG_INFO 6
+#define LOG_DEBUG 7
+#define LOG_DEFAULT LOG_INFO
+
+#define KERN_ERR "<3>"
+#define KERN_WARNING "<4>"
+#define KERN_INFO "<6>"
+#define KERN_DEBUG "<7>"
+
 void console_init (void);
+void console_start (void);
 void console_panic (void);
+void console_flush (void);
+void console_sync (void);
+void console_set_loglevel (int);
+size_t console_read_log (void *, size_t);
 void console_print_stats (void);
 
 #endif /* lib/kernel/console.h */
@@ -18,7 +18,15 @@
  * conversion from a struct hash_elem back to a structure object
  * that contains it.  This is the same technique used in the
  * linked list implementation.  Refer to lib/kernel/list.h for a
- * detailed explanation. */
+ * detailed explanation.
+ *
+ * Growing or shrinking the table does not move every element at
+ * once.  Instead the old bucket array is kept alongside the new
+ * one and a few old buckets are migrated by each insertion or
+ * deletion, so no single operation pays for a full rehash.
+ *
+ * See ohash.h for an open-addressing table with the same
+ * interface. */
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -59,6 +67,9 @@ struct hash {
 	size_t elem_cnt;            /* Number of elements in table. */
 	size_t bucket_cnt;          /* Number of buckets, a power of 2. */
 	struct list *buckets;       /* Array of `bucket_cnt' lists. */
+	size_t old_bucket_cnt;      /* Number of buckets in `old_buckets'. */
+	struct list *old_buckets;   /* Buckets being migrated, or null. */
+	size_t migrate_idx;         /* Next old bucket to migrate. */
 	hash_hash_func *hash;       /* Hash function. */
 	hash_less_func *less;       /* Comparison function. */
 	void *aux;                  /* Auxiliary data for `hash' and `less'. */
@@ -0,0 +1,71 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Binary heap.
+ *
+ * A min-heap ordered by a caller-supplied comparison function,
+ * with O(1) access to the least element and O(log n) insertion,
+ * removal of any element, and reordering of an element whose key
+ * has changed.
+ *
+ * Like lists, heaps do not use dynamic allocation.  Each
+ * structure that can be in a heap must embed a struct heap_elem
+ * member, and heap_entry converts a struct heap_elem back to the
+ * structure that contains it.  See lib/kernel/list.h for a
+ * detailed explanation of the technique.  Because there is no
+ * backing array, the heap is kept as a complete binary tree of
+ * linked elements, and the path to the last position is read off
+ * the bits of the element count.
+ *
+ * A heap is not ordered beyond its minimum and does not keep
+ * equal elements in insertion order.  Use a struct rbtree where
+ * either matters. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *parent;   /* Parent, or null for the root. */
+	struct heap_elem *left;     /* Left child, or null. */
+	struct heap_elem *right;    /* Right child, or null. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+ * the structure that HEAP_ELEM is embedded inside.  Supply the
+ * name of the outer structure STRUCT and the member name MEMBER
+ * of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)                   \
+	((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->parent           \
+		- offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two heap elements A and B, given
+ * auxiliary data AUX.  Returns true if A is less than B, or
+ * false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+		const struct heap_elem *b,
+		void *aux);
+
+/* Binary heap. */
+struct heap {
+	struct heap_elem *root;     /* Least element, or null if empty. */
+	size_t elem_cnt;            /* Number of elements in heap. */
+	heap_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+/* Insertion and removal. */
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+/* Information. */
+struct heap_elem *heap_min (struct heap *);
+size_t heap_size (struct heap *);
+bool heap_empty (struct heap *);
+
+#endif /* lib/kernel/heap.h */
@@ -0,0 +1,71 @@
+#ifndef __LIB_KERNEL_OHASH_H
+#define __LIB_KERNEL_OHASH_H
+
+/* Open-addressing hash table.
+ *
+ * This table has the same interface as the chained table in
+ * hash.h: elements embed a struct hash_elem, are converted back
+ * with hash_entry, and are hashed and compared with the same
+ * hash_hash_func and hash_less_func.  Instead of chaining, the
+ * table stores element pointers in a flat slot array, with one
+ * control byte per slot.
+ *
+ * A control byte is either empty, deleted, or the low 7 bits of
+ * the hash of the element in the slot.  Slots are probed in
+ * groups of 8, whose control bytes are read as a single 64-bit
+ * word and matched against the wanted tag all at once, so a
+ * lookup usually touches one control word and one slot.
+ *
+ * The table is resized in one go when it fills up.  Callers that
+ * need bounded latency can size it up front with ohash_reserve(),
+ * after which insertions never rehash until that many elements
+ * are present. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hash.h"
+
+/* Open-addressing hash table. */
+struct ohash {
+	size_t elem_cnt;            /* Number of elements in table. */
+	size_t slot_cnt;            /* Number of slots, a power of 2. */
+	size_t growth_left;         /* Insertions left before growing. */
+	uint8_t *ctrl;              /* Control bytes, one per slot. */
+	struct hash_elem **slots;   /* Array of `slot_cnt' elements. */
+	hash_hash_func *hash;       /* Hash function. */
+	hash_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `hash' and `less'. */
+};
+
+/* An open-addressing hash table iterator. */
+struct ohash_iterator {
+	struct ohash *hash;         /* The hash table. */
+	size_t slot;                /* Current slot. */
+	struct hash_elem *elem;     /* Current hash element. */
+};
+
+/* Basic life cycle. */
+bool ohash_init (struct ohash *, hash_hash_func *, hash_less_func *,
+		void *aux);
+bool ohash_reserve (struct ohash *, size_t);
+void ohash_clear (struct ohash *, hash_action_func *);
+void ohash_destroy (struct ohash *, hash_action_func *);
+
+/* Search, insertion, deletion. */
+struct hash_elem *ohash_insert (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_replace (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_find (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_delete (struct ohash *, struct hash_elem *);
+
+/* Iteration. */
+void ohash_apply (struct ohash *, hash_action_func *);
+void ohash_first (struct ohash_iterator *, struct ohash *);
+struct hash_elem *ohash_next (struct ohash_iterator *);
+struct hash_elem *ohash_cur (struct ohash_iterator *);
+
+/* Information. */
+size_t ohash_size (struct ohash *);
+bool ohash_empty (struct ohash *);
+
+#endif /* lib/kernel/ohash.h */
@@ -0,0 +1,91 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+ *
+ * A balanced binary search tree that keeps its elements sorted
+ * by a caller-supplied comparison function, with O(log n)
+ * insertion, removal and lookup, and O(1) access to the minimum.
+ *
+ * Like lists, trees do not use dynamic allocation.  Each
+ * structure that can be in a tree must embed a struct rb_elem
+ * member, and rb_entry converts a struct rb_elem back to the
+ * structure that contains it.  See lib/kernel/list.h for a
+ * detailed explanation of the technique.
+ *
+ * Equal elements are allowed.  A new element is placed after
+ * every element equal to it, so elements with equal keys come
+ * out in insertion order, just as with list_insert_ordered().
+ *
+ * Iteration idiom, in ascending order:
+ *
+ *   struct rb_elem *e;
+ *
+ *   for (e = rb_begin (&tree); e != rb_end (&tree); e = rb_next (e)) {
+ *     struct foo *f = rb_entry (e, struct foo, elem);
+ *     ...do something with f...
+ *   }
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Red-black tree element. */
+struct rb_elem {
+	struct rb_elem *parent;     /* Parent, or null for the root. */
+	struct rb_elem *left;       /* Left child, or null. */
+	struct rb_elem *right;      /* Right child, or null. */
+	bool red;                   /* True if red, false if black. */
+};
+
+/* Converts pointer to tree element RB_ELEM into a pointer to the
+ * structure that RB_ELEM is embedded inside.  Supply the name of
+ * the outer structure STRUCT and the member name MEMBER of the
+ * tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)                       \
+	((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent             \
+		- offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+ * auxiliary data AUX.  Returns true if A is less than B, or
+ * false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+		const struct rb_elem *b,
+		void *aux);
+
+/* Red-black tree. */
+struct rbtree {
+	struct rb_elem *root;       /* Root element, or null if empty. */
+	struct rb_elem *min;        /* Leftmost element, or null. */
+	size_t elem_cnt;            /* Number of elements in tree. */
+	rb_less_func *less;         /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void rb_init (struct rbtree *, rb_less_func *, void *aux);
+
+/* Insertion and removal. */
+void rb_insert (struct rbtree *, struct rb_elem *);
+void rb_remove (struct rbtree *, struct rb_elem *);
+struct rb_elem *rb_pop_min (struct rbtree *);
+
+/* Traversal.  rb_end() is a null pointer. */
+struct rb_elem *rb_begin (struct rbtree *);
+struct rb_elem *rb_rbegin (struct rbtree *);
+struct rb_elem *rb_end (struct rbtree *);
+struct rb_elem *rb_next (struct rb_elem *);
+struct rb_elem *rb_prev (struct rb_elem *);
+
+/* Lookup. */
+struct rb_elem *rb_min (struct rbtree *);
+struct rb_elem *rb_max (struct rbtree *);
+struct rb_elem *rb_find (struct rbtree *, const struct rb_elem *);
+struct rb_elem *rb_lower_bound (struct rbtree *, const struct rb_elem *);
+struct rb_elem *rb_upper_bound (struct rbtree *, const struct rb_elem *);
+
+/* Information. */
+size_t rb_size (struct rbtree *);
+bool rb_empty (struct rbtree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -0,0 +1,52 @@
+#ifndef __LIB_KERNEL_RING_H
+#define __LIB_KERNEL_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Single-producer, single-consumer ring buffer of bytes.
+
+   One context may add bytes to a ring while another removes them
+   at the same time, with no lock and without disabling
+   interrupts: the producer only ever writes HEAD and the
+   consumer only ever writes TAIL, and each publishes its index
+   only after the bytes it covers have been written or read.  A
+   typical use is an interrupt handler producing and a kernel
+   thread consuming, or the reverse.
+
+   If more than one context may produce (or consume), those
+   producers (or consumers) must be serialized among themselves,
+   e.g. by a lock or by disabling interrupts.
+
+   HEAD and TAIL count bytes ever added and removed, so they only
+   grow (wrapping at SIZE_MAX) and the ring can hold its full
+   capacity.  The capacity must be a power of 2, which lets an
+   index be reduced to a buffer offset with a mask. */
+struct ring {
+	uint8_t *buf;               /* Buffer. */
+	size_t mask;                /* Capacity - 1. */
+	size_t head;                /* Bytes added.  Written by producer. */
+	size_t tail;                /* Bytes removed.  Written by consumer. */
+};
+
+void ring_init (struct ring *, void *buf, size_t capacity);
+
+size_t ring_capacity (const struct ring *);
+size_t ring_count (const struct ring *);
+size_t ring_space (const struct ring *);
+bool ring_empty (const struct ring *);
+bool ring_full (const struct ring *);
+
+/* Producer side. */
+bool ring_putc (struct ring *, uint8_t);
+size_t ring_write (struct ring *, const void *, size_t);
+
+/* Consumer side. */
+int ring_getc (struct ring *);
+size_t ring_read (struct ring *, void *, size_t);
+
+/* History, with the producer excluded. */
+size_t ring_recent (const struct ring *, void *, size_t);
+
+#endif /* lib/kernel/ring.h */
@@ -0,0 +1,14 @@
+#ifndef __LIB_PMC_H
+#define __LIB_PMC_H
+
+/* Hardware performance counters, in the order the pmc_read()
+   system call reports them. */
+enum pmc_counter {
+	PMC_CYCLES,                 /* Unhalted core cycles. */
+	PMC_INSTRUCTIONS,           /* Instructions retired. */
+	PMC_LLC_MISSES,             /* Last-level cache misses. */
+	PMC_DTLB_MISSES,            /* Data TLB misses that walk the page table. */
+	PMC_CNT                     /* Number of counters. */
+};
+
+#endif /* lib/pmc.h */
@@ -2,6 +2,7 @@
 #define __LIB_STDLIB_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 /* Standard functions. */
 int atoi (const char *);
@@ -18,5 +19,7 @@ void *binary_search (const void *key, const void *array, size_t cnt,
 		size_t size,
 		int (*compare) (const void *, const void *, void *aux),
 		void *aux);
+void radix_sort_u8 (uint8_t *array, size_t cnt);
+void radix_sort_u32 (uint32_t *array, uint32_t *tmp, size_t cnt);
 
 #endif /* lib/stdlib.h */
@@ -36,6 +36,22 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extensions. */
+	SYS_DMESG,                  /* Read the kernel log. */
+	SYS_PMC_READ,               /* Read performance counters. */
+	SYS_SBRK,                   /* Move the program break. */
+	SYS_FUTEX_WAIT,             /* Sleep on a futex. */
+	SYS_FUTEX_WAKE,             /* Wake futex sleepers. */
+	SYS_THREAD_SPAWN,           /* Start a thread in this process. */
+	SYS_THREAD_JOIN,            /* Wait for a thread to exit. */
+	SYS_THREAD_EXIT,            /* End the calling thread. */
+	SYS_PIPE,                   /* Create a pipe. */
+	SYS_VMSPLICE,               /* Move pages into or out of a pipe. */
+	SYS_SHM_MAP,                /* Map a shared memory segment. */
+	SYS_SHM_UNLINK,             /* Remove a shared memory segment's name. */
+	SYS_IO_SETUP,               /* Set up asynchronous I/O rings. */
+	SYS_IO_ENTER,               /* Submit and wait for asynchronous I/O. */
 };
 
 #endif /* lib/syscall-nr.h */
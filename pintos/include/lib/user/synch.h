@@ -0,0 +1,33 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* Mutex.  Must be initialized with mutex_init() or
+   MUTEX_INITIALIZER. */
+struct mutex {
+	int state;                  /* 0: free, 1: held, 2: held, contended. */
+};
+
+#define MUTEX_INITIALIZER { 0 }
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* Condition variable.  Must be initialized with condvar_init()
+   or CONDVAR_INITIALIZER. */
+struct condvar {
+	int seq;                    /* Bumped by every signal. */
+	int waiter_cnt;             /* Threads in condvar_wait(). */
+};
+
+#define CONDVAR_INITIALIZER { 0, 0 }
+
+void condvar_init (struct condvar *);
+void condvar_wait (struct condvar *, struct mutex *);
+void condvar_signal (struct condvar *);
+void condvar_broadcast (struct condvar *);
+
+#endif /* lib/user/synch.h */
@@ -4,15 +4,29 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <pmc.h>
+#include <aio.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
+/* Function run by a thread started with thread_spawn().  Its
+   return value becomes the thread's exit status. */
+typedef int thread_func (void *aux);
+
 /* Map region identifier. */
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
 
+/* Flag for pipe2(): reads and writes fail instead of blocking. */
+#define PIPE_NONBLOCK 1
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -50,6 +64,28 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Extensions. */
+int dmesg (void *buffer, unsigned size);
+int pmc_read (uint64_t counts[], unsigned cnt);
+void *sbrk (intptr_t increment);
+int futex_wait (int *addr, int expected);
+int futex_wake (int *addr, int cnt);
+tid_t thread_spawn (thread_func *, void *stack, void *aux);
+int thread_join (tid_t);
+void thread_exit (int status) NO_RETURN;
+int pipe (int fds[2]);
+int pipe2 (int fds[2], int flags);
+int vmsplice (int fd, void *buffer, unsigned size);
+void *shm_map (const char *name, void *addr, size_t size);
+bool shm_unlink (const char *name);
+struct io_rings *io_setup (void *addr, unsigned entries);
+int io_enter (unsigned to_submit, unsigned min_complete);
+
+/* Output buffering, in lib/user/console.c.  Declared here rather
+   than in <stdio.h>, which resolves to the kernel's stdio.h. */
+int fflush (int handle);
+void __fclose (int handle);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
@@ -39,6 +39,8 @@ void sema_self_test(void);
 
 bool compare_sema_priority(const struct list_elem *a, const struct list_elem *b, void *aux);
 
+struct thread;
+
 /* Lock. */
 struct lock
 {
@@ -52,6 +54,8 @@ bool lock_try_acquire(struct lock *);
 void lock_release(struct lock *);
 bool lock_held_by_current_thread(const struct lock *);
 void recalculate_priority(void);
+void donate_priority(struct thread *);
+void remove_donations(struct lock *);
 
 /* Condition variable. */
 struct condition
@@ -1,9 +1,11 @@
 #ifndef THREADS_THREAD_H
 #define THREADS_THREAD_H
 
+#include <console.h>
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include "devices/pmu.h"
 #include "threads/interrupt.h"
 #ifdef VM
 #include "vm/vm.h"
@@ -43,9 +45,17 @@ struct thread
 	struct list_elem elem; /* List element. */
 	int64_t wakeup_tick;	 /* Wakeup tick. */
 
+	/* Owned by lib/kernel/console.c. */
+	struct console_line console_line; /* Buffered console output. */
+
+	/* Owned by devices/pmu.c. */
+	struct pmu_counts pmu; /* Performance counters. */
+
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
 	uint64_t *pml4; /* Page map level 4 */
+	struct thread_group *group;	 /* Threads sharing the address space. */
+	struct group_member *member; /* Join record, null for the leader. */
 #endif
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
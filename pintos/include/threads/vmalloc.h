@@ -0,0 +1,11 @@
+#ifndef THREADS_VMALLOC_H
+#define THREADS_VMALLOC_H
+
+#include <stddef.h>
+
+void vmalloc_init (void);
+void *vmalloc (size_t) __attribute__ ((malloc));
+void *vcalloc (size_t, size_t) __attribute__ ((malloc));
+void vfree (void *);
+
+#endif /* threads/vmalloc.h */
@@ -0,0 +1,44 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Function run by a work item, given the item's AUX. */
+typedef void work_func (void *aux);
+
+/* States of a work item. */
+enum work_state {
+	WORK_IDLE,                  /* Not queued. */
+	WORK_DELAYED,               /* Waiting for its tick to come. */
+	WORK_QUEUED                 /* Waiting for a worker thread. */
+};
+
+/* A deferred function call.  Owned by the caller, which must
+   keep it alive until it has run or been cancelled. */
+struct work {
+	struct list_elem elem;      /* Delayed list or workqueue element. */
+	work_func *func;            /* Function to run. */
+	void *aux;                  /* Argument to FUNC. */
+	struct workqueue *wq;       /* Queue it was last queued on. */
+	int64_t expires;            /* Tick to queue delayed work at. */
+	enum work_state state;      /* Current state. */
+};
+
+/* Shared queue for work that needs no queue of its own. */
+extern struct workqueue *system_wq;
+
+void workqueue_init (void);
+struct workqueue *workqueue_create (const char *name, int priority,
+		size_t thread_cnt);
+void workqueue_tick (int64_t now);
+
+void work_init (struct work *, work_func *, void *aux);
+bool queue_work (struct workqueue *, struct work *);
+bool queue_delayed_work (struct workqueue *, struct work *, int64_t ticks);
+bool cancel_work (struct work *);
+void flush_work (struct work *);
+
+#endif /* threads/workqueue.h */
@@ -0,0 +1,11 @@
+#ifndef USERPROG_AIO_H
+#define USERPROG_AIO_H
+
+#include <stdint.h>
+
+void aio_init (void);
+int aio_setup (void *addr, unsigned entries);
+int aio_enter (unsigned to_submit, unsigned min_complete);
+void aio_cleanup (uint64_t *pml4);
+
+#endif /* userprog/aio.h */
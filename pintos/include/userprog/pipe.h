@@ -0,0 +1,31 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Pipe descriptors run from PIPE_FD_MIN to PIPE_FD_CNT - 1.
+   Descriptors 0 and 1 are the console. */
+#define PIPE_FD_MIN 2
+#define PIPE_FD_CNT 32
+
+/* Flag for the pipe system call, as in lib/user/syscall.h. */
+#define PIPE_NONBLOCK 1
+
+/* One end of a pipe, as held by a file descriptor. */
+struct pipe_fd {
+	struct pipe *pipe;          /* Pipe, or null if the descriptor is free. */
+	bool writer;                /* Write end? */
+	bool nonblock;              /* Fail instead of blocking? */
+};
+
+struct pipe *pipe_create (void);
+void pipe_open (struct pipe *, bool writer);
+void pipe_close (struct pipe *, bool writer);
+void pipe_wake (struct pipe *);
+int pipe_read (struct pipe *, void *buffer, size_t size,
+		bool nonblock, bool flip);
+int pipe_write (struct pipe *, void *buffer, size_t size,
+		bool nonblock, bool flip);
+
+#endif /* userprog/pipe.h */
@@ -2,6 +2,7 @@
 #define USERPROG_PROCESS_H
 
 #include "threads/thread.h"
+#include "userprog/pipe.h"
 
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
@@ -9,5 +10,16 @@ int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
+void *process_sbrk (intptr_t increment);
+tid_t process_spawn (void *entry, void *stack, void *arg);
+int process_join (tid_t);
+void process_thread_exit (int status) NO_RETURN;
+bool process_exiting (void);
+int process_pipe (int fds[2], bool nonblock);
+bool process_get_pipe (int fd, struct pipe_fd *);
+bool process_close_pipe (int fd);
+#ifdef VM
+struct supplemental_page_table *process_spt (void);
+#endif
 
 #endif /* userprog/process.h */
@@ -0,0 +1,22 @@
+#ifndef USERPROG_SHM_H
+#define USERPROG_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Maximum length of a segment name, and of a segment. */
+#define SHM_NAME_MAX 14
+#define SHM_PAGES_MAX 1024
+
+void shm_init (void);
+void *shm_map (const char *name, void *addr, size_t size);
+bool shm_unmap (void *addr);
+bool shm_unlink (const char *name);
+struct shm *shm_map_page (void *addr, void **kpage);
+void shm_put (struct shm *);
+bool shm_mapped (uint64_t *pml4, const void *va);
+bool shm_fork (uint64_t *child, uint64_t *parent);
+void shm_unmap_all (uint64_t *pml4);
+
+#endif /* userprog/shm.h */
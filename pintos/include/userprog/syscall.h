@@ -1,6 +1,17 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 void syscall_init (void);
+bool user_buffer_ok (const void *uaddr, size_t size, bool writable);
+bool copy_in_string (char *dst, const char *usrc, size_t size);
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
+
+/* Instructions in get_user() and put_user() whose page faults
+   are recovered from. */
+extern const char get_user_load[], put_user_store[];
 
 #endif /* userprog/syscall.h */
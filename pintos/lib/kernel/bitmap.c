@@ -62,6 +62,51 @@ last_mask (const struct bitmap *b) {
 	int last_bits = b->bit_cnt % ELEM_BITS;
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Returns an elem_type with bits BIT_IDX % ELEM_BITS and up set to
+   1, and the bits below it set to 0. */
+static inline elem_type
+mask_from (size_t bit_idx) {
+	return (elem_type) -1 << (bit_idx % ELEM_BITS);
+}
+
+/* Returns the index of the first bit in B between START and END,
+   exclusive, that is set to VALUE, or END if there is none.
+
+   Works a whole element at a time: an element with no bit set to
+   VALUE is skipped in one step, and otherwise the first such bit
+   is found by counting trailing zeros. */
+static size_t
+find_bit (const struct bitmap *b, size_t start, size_t end, bool value) {
+	elem_type flip = value ? 0 : (elem_type) -1;
+	size_t idx;
+	elem_type word;
+
+	if (start >= end)
+		return end;
+
+	idx = elem_idx (start);
+	word = (b->bits[idx] ^ flip) & mask_from (start);
+	while (word == 0) {
+		if (++idx >= elem_cnt (end))
+			return end;
+		word = b->bits[idx] ^ flip;
+	}
+
+	start = idx * ELEM_BITS + __builtin_ctzl (word);
+	return start < end ? start : end;
+}
+
+/* Sets the bits in element IDX of B that are set in MASK to
+   VALUE, atomically. */
+static void
+set_mask (struct bitmap *b, size_t idx, elem_type mask, bool value) {
+	/* See bitmap_mark() and bitmap_reset(). */
+	if (value)
+		asm ("lock orq %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
+	else
+		asm ("lock andq %1, %0" : "+m" (b->bits[idx]) : "r" (~mask) : "cc");
+}
 
 /* Creation and destruction. */
 
@@ -147,7 +192,7 @@ bitmap_mark (struct bitmap *b, size_t bit_idx) {
 	/* This is equivalent to `b->bits[idx] |= mask' except that it
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the OR instruction in [IA32-v2b]. */
-	asm ("lock orq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	asm ("lock orq %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -159,7 +204,7 @@ bitmap_reset (struct bitmap *b, size_t bit_idx) {
 	/* This is equivalent to `b->bits[idx] &= ~mask' except that it
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the AND instruction in [IA32-v2a]. */
-	asm ("lock andq %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+	asm ("lock andq %1, %0" : "+m" (b->bits[idx]) : "r" (~mask) : "cc");
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -173,7 +218,7 @@ bitmap_flip (struct bitmap *b, size_t bit_idx) {
 	/* This is equivalent to `b->bits[idx] ^= mask' except that it
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the XOR instruction in [IA32-v2b]. */
-	asm ("lock xorq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	asm ("lock xorq %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -194,17 +239,26 @@ bitmap_set_all (struct bitmap *b, bool value) {
 	bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically, but the bits as a whole
+   are not. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
+	size_t end = start + cnt;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	while (start < end) {
+		size_t idx = elem_idx (start);
+		elem_type mask = mask_from (start);
+
+		if (idx == elem_idx (end - 1))
+			mask &= (elem_type) -1 >> (ELEM_BITS - 1 - (end - 1) % ELEM_BITS);
+		set_mask (b, idx, mask, value);
+		start = (idx + 1) * ELEM_BITS;
+	}
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -228,16 +282,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			return true;
-	return false;
+	return find_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -263,6 +312,33 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 
 /* Finding set or unset bits. */
 
+/* Finds and returns the starting index of the first group of CNT
+   consecutive bits in B that are all set to VALUE and lie
+   between START and END, exclusive.
+   If there is no such group, returns BITMAP_ERROR. */
+static size_t
+scan_range (const struct bitmap *b, size_t start, size_t end, size_t cnt,
+		bool value) {
+	if (cnt == 0)
+		return start <= end ? start : BITMAP_ERROR;
+
+	/* Jump from run to run of VALUE bits: find where the next run
+	   starts, then where it ends.  A run that is too short is
+	   skipped as a whole, so each bit is examined about once. */
+	while (start < end && end - start >= cnt) {
+		size_t run_end;
+
+		start = find_bit (b, start, end, value);
+		if (end - start < cnt)
+			break;
+		run_end = find_bit (b, start, start + cnt, !value);
+		if (run_end - start >= cnt)
+			return start;
+		start = run_end;
+	}
+	return BITMAP_ERROR;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
@@ -272,14 +348,35 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
-	if (cnt <= b->bit_cnt) {
-		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
-				return i;
+	return scan_range (b, start, b->bit_cnt, cnt, value);
+}
+
+/* Finds and returns the starting index of a group of CNT
+   consecutive bits in B that are all set to VALUE, looking first
+   at or after HINT and then wrapping around to the beginning of
+   B.  Passing the end of the previous allocation as HINT keeps
+   allocation from rescanning the full part of a mostly full
+   bitmap each time.  HINT may be any value; it is reduced modulo
+   the size of B.
+   If there is no such group, returns BITMAP_ERROR. */
+size_t
+bitmap_scan_hint (const struct bitmap *b, size_t hint, size_t cnt, bool value) {
+	size_t idx;
+
+	ASSERT (b != NULL);
+
+	if (b->bit_cnt == 0)
+		return scan_range (b, 0, 0, cnt, value);
+	hint %= b->bit_cnt;
+
+	idx = scan_range (b, hint, b->bit_cnt, cnt, value);
+	if (idx == BITMAP_ERROR && hint > 0) {
+		/* Groups that start before HINT may extend past it. */
+		size_t end = hint - 1 + cnt;
+		idx = scan_range (b, 0, end < b->bit_cnt ? end : b->bit_cnt,
+				cnt, value);
 	}
-	return BITMAP_ERROR;
+	return idx;
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
@@ -1,14 +1,20 @@
 #include <console.h>
 #include <stdarg.h>
+#include <ring.h>
 #include <stdio.h>
 #include "devices/serial.h"
 #include "devices/vga.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 static void vprintf_helper (char, void *);
-static void putchar_have_lock (uint8_t c);
+static void putchar_buffered (uint8_t c);
+static void flush_line (struct console_line *);
+static void write_have_lock (const char *, size_t);
+static void acquire_console (void);
+static void release_console (void);
 
 /* The console lock.
    Both the vga and serial layers do their own locking, so it's
@@ -59,25 +65,149 @@ static int console_lock_depth;
 /* Number of characters written to console. */
 static int64_t write_cnt;
 
+/* Output is collected in a per-thread line buffer, in the
+   running thread's struct console_line, and only added to the
+   kernel log once a whole line (or CONSOLE_LINE_MAX bytes) has
+   accumulated.  This keeps lines from different threads from
+   interleaving in the log.
+
+   Buffering is only possible when there is a thread to buffer
+   in and the console lock works, so interrupt handlers, early
+   boot and panics add their output to the log directly. */
+
+/* Kernel log size, in bytes.  Must be a power of 2. */
+#ifndef LOG_BUF_SIZE
+#define LOG_BUF_SIZE 65536
+#endif
+
+/* Bytes the log is drained in at a time. */
+#define LOG_CHUNK 128
+
+/* The kernel log: every byte of console output, in order.
+
+   Adding to the log only copies bytes, with interrupts briefly
+   off to serialize producers, so printf() does not wait for the
+   serial port.  Once console_start() has been called, a
+   low-priority kernel thread drains the log to the vga display
+   and serial port in the background.  Before that, and after
+   console_sync() or a panic, whoever adds to the log drains it
+   at once.  A producer that finds the log full also drains it,
+   or in an interrupt handler, drops what does not fit.
+
+   The log keeps the last LOG_BUF_SIZE bytes written, including
+   those already drained, for console_read_log(). */
+static struct ring log_ring;
+static uint8_t log_buf[LOG_BUF_SIZE];
+
+/* True while the drain thread is responsible for the log. */
+static bool log_async;
+
+/* The drain thread, if it is waiting for output. */
+static struct thread *log_waiter;
+
+/* Number of bytes dropped because the log was full. */
+static int64_t log_dropped;
+
+/* Lines at this level or above are not written to the console. */
+static int console_loglevel = LOG_DEBUG;
+
+/* Where the drain is in the current line, for stripping log level
+   prefixes and filtering lines by level. */
+static enum {
+	LINE_START,                 /* Nothing of the line seen yet. */
+	AFTER_LT,                   /* Seen "<". */
+	AFTER_LEVEL,                /* Seen "<" and a digit. */
+	LINE_SHOWN,                 /* In a line being written. */
+	LINE_HIDDEN                 /* In a line being suppressed. */
+} line_state;
+
+/* Level read from the current line's prefix. */
+static int line_level;
+
+static void log_write (const char *, size_t);
+static void drain_log (void);
+static void log_drain_thread (void *);
+
 /* Enable console locking. */
 void
 console_init (void) {
+	ring_init (&log_ring, log_buf, sizeof log_buf);
 	lock_init (&console_lock);
 	use_console_lock = true;
 }
 
+/* Starts the thread that drains the kernel log, making console
+   output asynchronous.  Must be called after thread_start(). */
+void
+console_start (void) {
+	if (thread_create ("klogd", PRI_MIN, log_drain_thread, NULL) != TID_ERROR)
+		log_async = true;
+}
+
 /* Notifies the console that a kernel panic is underway,
    which warns it to avoid trying to take the console lock from
-   now on. */
+   now on, and writes out everything logged so far. */
 void
 console_panic (void) {
+	bool flush = use_console_lock && !intr_context ();
+
+	/* Stop locking first, so that the flush below cannot block and
+	   a failure inside it just recurses into a plain panic. */
 	use_console_lock = false;
+	log_async = false;
+	if (flush)
+		flush_line (&thread_current ()->console_line);
+	drain_log ();
+}
+
+/* Adds any output the running thread has buffered to the log.
+   Called before the thread exits, and usable by anyone who needs
+   partial lines to appear now. */
+void
+console_flush (void) {
+	if (use_console_lock && !intr_context ())
+		flush_line (&thread_current ()->console_line);
+}
+
+/* Writes out everything the running thread has buffered and
+   everything in the log, and makes later output synchronous.
+   Called before the machine powers off. */
+void
+console_sync (void) {
+	console_flush ();
+	log_async = false;
+
+	acquire_console ();
+	drain_log ();
+	release_console ();
+}
+
+/* Sets the console log level to LEVEL: lines logged at LEVEL or
+   above are kept in the log but not written to the console. */
+void
+console_set_loglevel (int level) {
+	console_loglevel = level;
+}
+
+/* Copies up to SIZE of the most recently logged bytes into
+   BUFFER, oldest first, and returns the number of bytes copied.
+   The copy includes log level prefixes and lines filtered from
+   the console.  The copy runs with interrupts off, so BUFFER must
+   be kernel memory. */
+size_t
+console_read_log (void *buffer, size_t size) {
+	enum intr_level old_level = intr_disable ();
+	size_t n = ring_recent (&log_ring, buffer, size);
+	intr_set_level (old_level);
+	return n;
 }
 
 /* Prints console statistics. */
 void
 console_print_stats (void) {
 	printf ("Console: %lld characters output\n", write_cnt);
+	if (log_dropped > 0)
+		printf ("Console: %lld characters dropped from log\n", log_dropped);
 }
 
 /* Acquires the console lock. */
@@ -111,6 +241,15 @@ console_locked_by_current_thread (void) {
 			|| lock_held_by_current_thread (&console_lock));
 }
 
+/* Returns the running thread's line buffer, or a null pointer if
+   output must be added to the log directly. */
+static struct console_line *
+current_line (void) {
+	if (!use_console_lock || intr_context ())
+		return NULL;
+	return &thread_current ()->console_line;
+}
+
 /* The standard vprintf() function,
    which is like printf() but uses a va_list.
    Writes its output to both vga display and serial port. */
@@ -118,9 +257,7 @@ int
 vprintf (const char *format, va_list args) {
 	int char_cnt = 0;
 
-	acquire_console ();
 	__vprintf (format, args, vprintf_helper, &char_cnt);
-	release_console ();
 
 	return char_cnt;
 }
@@ -129,49 +266,195 @@ vprintf (const char *format, va_list args) {
    character. */
 int
 puts (const char *s) {
-	acquire_console ();
 	while (*s != '\0')
-		putchar_have_lock (*s++);
-	putchar_have_lock ('\n');
-	release_console ();
+		putchar_buffered (*s++);
+	putchar_buffered ('\n');
 
 	return 0;
 }
 
-/* Writes the N characters in BUFFER to the console. */
+/* Writes the N characters in BUFFER to the console.  BUFFER is
+   written as one block, after any output the running thread
+   already has buffered. */
 void
 putbuf (const char *buffer, size_t n) {
-	acquire_console ();
-	while (n-- > 0)
-		putchar_have_lock (*buffer++);
-	release_console ();
+	struct console_line *line = current_line ();
+
+	if (line != NULL)
+		flush_line (line);
+	log_write (buffer, n);
 }
 
 /* Writes C to the vga display and serial port. */
 int
 putchar (int c) {
-	acquire_console ();
-	putchar_have_lock (c);
-	release_console ();
+	putchar_buffered (c);
 
 	return c;
 }
-
+
 /* Helper function for vprintf(). */
 static void
 vprintf_helper (char c, void *char_cnt_) {
 	int *char_cnt = char_cnt_;
 	(*char_cnt)++;
-	putchar_have_lock (c);
+	putchar_buffered (c);
+}
+
+/* Appends C to the running thread's line buffer, adding the
+   buffer to the log at the end of a line or when it fills up.
+   Adds C to the log directly if there is no buffer to use. */
+static void
+putchar_buffered (uint8_t c) {
+	struct console_line *line = current_line ();
+
+	if (line == NULL) {
+		char ch = c;
+
+		log_write (&ch, 1);
+		return;
+	}
+
+	line->buf[line->len++] = c;
+	if (c == '\n' || line->len >= sizeof line->buf)
+		flush_line (line);
 }
 
-/* Writes C to the vga display and serial port.
-   The caller has already acquired the console lock if
+/* Adds LINE to the log and empties it. */
+static void
+flush_line (struct console_line *line) {
+	if (line->len == 0)
+		return;
+
+	log_write (line->buf, line->len);
+	line->len = 0;
+}
+
+/* Adds the N bytes in BUFFER to the log, then either wakes the
+   drain thread or, if output is synchronous or BUFFER does not
+   fit, drains the log here. */
+static void
+log_write (const char *buffer, size_t n) {
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		size_t written = ring_write (&log_ring, buffer, n);
+		if (log_async && log_waiter != NULL) {
+			thread_unblock (log_waiter);
+			log_waiter = NULL;
+		}
+		intr_set_level (old_level);
+
+		buffer += written;
+		n -= written;
+		if (n == 0 && log_async)
+			return;
+
+		/* An interrupt handler cannot wait for the thread that is
+		   draining the log, so it leaves the log to that thread. */
+		if (intr_context () && use_console_lock) {
+			log_dropped += n;
+			return;
+		}
+
+		acquire_console ();
+		drain_log ();
+		release_console ();
+		if (n == 0)
+			return;
+	}
+}
+
+/* Returns the state that begins a line logged at LEVEL. */
+static int
+line_begin (int level) {
+	return level < console_loglevel ? LINE_SHOWN : LINE_HIDDEN;
+}
+
+/* Copies the N bytes of log at IN to OUT, stripping log level
+   prefixes and dropping lines filtered by level, and returns the
+   number of bytes in OUT.  OUT must have room for N + 2 bytes,
+   since a "<" and digit that turn out not to be a prefix are only
+   copied once the byte after them has been seen. */
+static size_t
+filter_log (const char *in, size_t n, char *out) {
+	char *start = out;
+
+	for (; n > 0; n--) {
+		char c = *in++;
+
+		if (line_state == LINE_START) {
+			if (c == '<') {
+				line_state = AFTER_LT;
+				continue;
+			}
+			line_state = line_begin (LOG_DEFAULT);
+		} else if (line_state == AFTER_LT) {
+			if (c >= '0' && c <= '9') {
+				line_level = c - '0';
+				line_state = AFTER_LEVEL;
+				continue;
+			}
+			line_state = line_begin (LOG_DEFAULT);
+			if (line_state == LINE_SHOWN)
+				*out++ = '<';
+		} else if (line_state == AFTER_LEVEL) {
+			if (c == '>') {
+				line_state = line_begin (line_level);
+				continue;
+			}
+			line_state = line_begin (LOG_DEFAULT);
+			if (line_state == LINE_SHOWN) {
+				*out++ = '<';
+				*out++ = '0' + line_level;
+			}
+		}
+
+		if (line_state == LINE_SHOWN)
+			*out++ = c;
+		if (c == '\n')
+			line_state = LINE_START;
+	}
+	return out - start;
+}
+
+/* Writes everything in the log to the vga display and serial
+   port.  The caller has already acquired the console lock if
+   appropriate. */
+static void
+drain_log (void) {
+	char in[LOG_CHUNK], out[LOG_CHUNK + 2];
+	size_t n;
+
+	while ((n = ring_read (&log_ring, in, sizeof in)) > 0)
+		write_have_lock (out, filter_log (in, n, out));
+}
+
+/* Thread function that drains the log whenever output is added
+   to it. */
+static void
+log_drain_thread (void *aux UNUSED) {
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		while (ring_empty (&log_ring)) {
+			log_waiter = thread_current ();
+			thread_block ();
+		}
+		intr_set_level (old_level);
+
+		acquire_console ();
+		drain_log ();
+		release_console ();
+	}
+}
+
+/* Writes the N bytes in BUFFER to the vga display and serial
+   port.  The caller has already acquired the console lock if
    appropriate. */
 static void
-putchar_have_lock (uint8_t c) {
+write_have_lock (const char *buffer, size_t n) {
 	ASSERT (console_locked_by_current_thread ());
-	write_cnt++;
-	serial_putc (c);
-	vga_putc (c);
+	write_cnt += n;
+	serial_write (buffer, n);
+	while (n-- > 0)
+		vga_putc (*buffer++);
 }
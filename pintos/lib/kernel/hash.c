@@ -15,9 +15,13 @@
 static struct list *find_bucket (struct hash *, struct hash_elem *);
 static struct hash_elem *find_elem (struct hash *, struct list *,
 		struct hash_elem *);
+static struct hash_elem *lookup (struct hash *, struct hash_elem *,
+		struct list **);
+static struct list *next_bucket (struct hash *, struct list *);
 static void insert_elem (struct hash *, struct list *, struct hash_elem *);
 static void remove_elem (struct hash *, struct hash_elem *);
 static void rehash (struct hash *);
+static void migrate (struct hash *, size_t);
 
 /* Initializes hash table H to compute hash values using HASH and
    compare hash elements using LESS, given auxiliary data AUX. */
@@ -27,6 +31,9 @@ hash_init (struct hash *h,
 	h->elem_cnt = 0;
 	h->bucket_cnt = 4;
 	h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
+	h->old_bucket_cnt = 0;
+	h->old_buckets = NULL;
+	h->migrate_idx = 0;
 	h->hash = hash;
 	h->less = less;
 	h->aux = aux;
@@ -49,11 +56,11 @@ hash_init (struct hash *h,
    whether done in DESTRUCTOR or elsewhere. */
 void
 hash_clear (struct hash *h, hash_action_func *destructor) {
+	struct list *bucket;
 	size_t i;
 
-	for (i = 0; i < h->bucket_cnt; i++) {
-		struct list *bucket = &h->buckets[i];
-
+	for (bucket = h->buckets; bucket != NULL;
+			bucket = next_bucket (h, bucket))
 		if (destructor != NULL)
 			while (!list_empty (bucket)) {
 				struct list_elem *list_elem = list_pop_front (bucket);
@@ -61,8 +68,14 @@ hash_clear (struct hash *h, hash_action_func *destructor) {
 				destructor (hash_elem, h->aux);
 			}
 
-		list_init (bucket);
-	}
+	for (i = 0; i < h->bucket_cnt; i++)
+		list_init (&h->buckets[i]);
+
+	/* Nothing is left to migrate. */
+	free (h->old_buckets);
+	h->old_buckets = NULL;
+	h->old_bucket_cnt = 0;
+	h->migrate_idx = 0;
 
 	h->elem_cnt = 0;
 }
@@ -81,6 +94,7 @@ void
 hash_destroy (struct hash *h, hash_action_func *destructor) {
 	if (destructor != NULL)
 		hash_clear (h, destructor);
+	free (h->old_buckets);
 	free (h->buckets);
 }
 
@@ -90,8 +104,8 @@ hash_destroy (struct hash *h, hash_action_func *destructor) {
    without inserting NEW. */
 struct hash_elem *
 hash_insert (struct hash *h, struct hash_elem *new) {
-	struct list *bucket = find_bucket (h, new);
-	struct hash_elem *old = find_elem (h, bucket, new);
+	struct list *bucket;
+	struct hash_elem *old = lookup (h, new, &bucket);
 
 	if (old == NULL)
 		insert_elem (h, bucket, new);
@@ -105,8 +119,8 @@ hash_insert (struct hash *h, struct hash_elem *new) {
    already in the table, which is returned. */
 struct hash_elem *
 hash_replace (struct hash *h, struct hash_elem *new) {
-	struct list *bucket = find_bucket (h, new);
-	struct hash_elem *old = find_elem (h, bucket, new);
+	struct list *bucket;
+	struct hash_elem *old = lookup (h, new, &bucket);
 
 	if (old != NULL)
 		remove_elem (h, old);
@@ -121,7 +135,7 @@ hash_replace (struct hash *h, struct hash_elem *new) {
    null pointer if no equal element exists in the table. */
 struct hash_elem *
 hash_find (struct hash *h, struct hash_elem *e) {
-	return find_elem (h, find_bucket (h, e), e);
+	return lookup (h, e, NULL);
 }
 
 /* Finds, removes, and returns an element equal to E in hash
@@ -133,7 +147,7 @@ hash_find (struct hash *h, struct hash_elem *e) {
    responsibility to deallocate them. */
 struct hash_elem *
 hash_delete (struct hash *h, struct hash_elem *e) {
-	struct hash_elem *found = find_elem (h, find_bucket (h, e), e);
+	struct hash_elem *found = lookup (h, e, NULL);
 	if (found != NULL) {
 		remove_elem (h, found);
 		rehash (h);
@@ -149,12 +163,12 @@ hash_delete (struct hash *h, struct hash_elem *e) {
    undefined behavior, whether done from ACTION or elsewhere. */
 void
 hash_apply (struct hash *h, hash_action_func *action) {
-	size_t i;
+	struct list *bucket;
 
 	ASSERT (action != NULL);
 
-	for (i = 0; i < h->bucket_cnt; i++) {
-		struct list *bucket = &h->buckets[i];
+	for (bucket = h->buckets; bucket != NULL;
+			bucket = next_bucket (h, bucket)) {
 		struct list_elem *elem, *next;
 
 		for (elem = list_begin (bucket); elem != list_end (bucket); elem = next) {
@@ -205,7 +219,8 @@ hash_next (struct hash_iterator *i) {
 
 	i->elem = list_elem_to_hash_elem (list_next (&i->elem->list_elem));
 	while (i->elem == list_elem_to_hash_elem (list_end (i->bucket))) {
-		if (++i->bucket >= i->hash->buckets + i->hash->bucket_cnt) {
+		i->bucket = next_bucket (i->hash, i->bucket);
+		if (i->bucket == NULL) {
 			i->elem = NULL;
 			break;
 		}
@@ -297,6 +312,44 @@ find_elem (struct hash *h, struct list *bucket, struct hash_elem *e) {
 	return NULL;
 }
 
+/* Searches H for a hash element equal to E, looking in the old
+   bucket array too while a rehash is in progress.  Returns it if
+   found or a null pointer otherwise.  If BUCKETP is non-null,
+   stores the bucket in the current array that E belongs in. */
+static struct hash_elem *
+lookup (struct hash *h, struct hash_elem *e, struct list **bucketp) {
+	uint64_t hash = h->hash (e, h->aux);
+	struct list *bucket = &h->buckets[hash & (h->bucket_cnt - 1)];
+	struct hash_elem *found = find_elem (h, bucket, e);
+
+	if (found == NULL && h->old_buckets != NULL) {
+		size_t old_idx = hash & (h->old_bucket_cnt - 1);
+		if (old_idx >= h->migrate_idx)
+			found = find_elem (h, &h->old_buckets[old_idx], e);
+	}
+
+	if (bucketp != NULL)
+		*bucketp = bucket;
+	return found;
+}
+
+/* Returns the bucket that follows BUCKET in H, visiting the
+   current bucket array and then the old buckets that have not
+   been migrated yet.  Returns a null pointer after the last
+   bucket. */
+static struct list *
+next_bucket (struct hash *h, struct list *bucket) {
+	bucket++;
+	if (bucket == h->buckets + h->bucket_cnt) {
+		if (h->old_buckets == NULL
+				|| h->migrate_idx >= h->old_bucket_cnt)
+			return NULL;
+		bucket = h->old_buckets + h->migrate_idx;
+	} else if (bucket == h->old_buckets + h->old_bucket_cnt)
+		return NULL;
+	return bucket;
+}
+
 /* Returns X with its lowest-order bit set to 1 turned off. */
 static inline size_t
 turn_off_least_1bit (size_t x) {
@@ -314,21 +367,31 @@ is_power_of_2 (size_t x) {
 #define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
 #define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
 
+/* Number of old buckets migrated per insertion or deletion.
+   Growing doubles the bucket count at most, so a rehash started
+   at N buckets is finished after N / MIGRATE_STEP operations,
+   long before the table can need another one. */
+#define MIGRATE_STEP 2
+
 /* Changes the number of buckets in hash table H to match the
-   ideal.  This function can fail because of an out-of-memory
-   condition, but that'll just make hash accesses less efficient;
-   we can still continue. */
+   ideal.  The elements are not moved here: the old array is
+   kept and migrate() drains it a few buckets at a time.  While a
+   migration is in progress this only advances it.  This
+   function can fail because of an out-of-memory condition, but
+   that'll just make hash accesses less efficient; we can still
+   continue. */
 static void
 rehash (struct hash *h) {
-	size_t old_bucket_cnt, new_bucket_cnt;
-	struct list *new_buckets, *old_buckets;
+	size_t new_bucket_cnt;
+	struct list *new_buckets;
 	size_t i;
 
 	ASSERT (h != NULL);
 
-	/* Save old bucket info for later use. */
-	old_buckets = h->buckets;
-	old_bucket_cnt = h->bucket_cnt;
+	if (h->old_buckets != NULL) {
+		migrate (h, MIGRATE_STEP);
+		return;
+	}
 
 	/* Calculate the number of buckets to use now.
 	   We want one bucket for about every BEST_ELEMS_PER_BUCKET.
@@ -341,7 +404,7 @@ rehash (struct hash *h) {
 		new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
 
 	/* Don't do anything if the bucket count wouldn't change. */
-	if (new_bucket_cnt == old_bucket_cnt)
+	if (new_bucket_cnt == h->bucket_cnt)
 		return;
 
 	/* Allocate new buckets and initialize them as empty. */
@@ -355,27 +418,39 @@ rehash (struct hash *h) {
 	for (i = 0; i < new_bucket_cnt; i++)
 		list_init (&new_buckets[i]);
 
-	/* Install new bucket info. */
+	/* Install new bucket info, keeping the old buckets around
+	   until they have been migrated. */
+	h->old_buckets = h->buckets;
+	h->old_bucket_cnt = h->bucket_cnt;
+	h->migrate_idx = 0;
 	h->buckets = new_buckets;
 	h->bucket_cnt = new_bucket_cnt;
 
-	/* Move each old element into the appropriate new bucket. */
-	for (i = 0; i < old_bucket_cnt; i++) {
-		struct list *old_bucket;
-		struct list_elem *elem, *next;
+	migrate (h, MIGRATE_STEP);
+}
+
+/* Moves the elements of up to CNT old buckets in H into the
+   appropriate new buckets, and frees the old bucket array once
+   it is empty. */
+static void
+migrate (struct hash *h, size_t cnt) {
+	while (cnt-- > 0 && h->migrate_idx < h->old_bucket_cnt) {
+		struct list *old_bucket = &h->old_buckets[h->migrate_idx++];
 
-		old_bucket = &old_buckets[i];
-		for (elem = list_begin (old_bucket);
-				elem != list_end (old_bucket); elem = next) {
+		while (!list_empty (old_bucket)) {
+			struct list_elem *elem = list_pop_front (old_bucket);
 			struct list *new_bucket
 				= find_bucket (h, list_elem_to_hash_elem (elem));
-			next = list_next (elem);
-			list_remove (elem);
 			list_push_front (new_bucket, elem);
 		}
 	}
 
-	free (old_buckets);
+	if (h->migrate_idx >= h->old_bucket_cnt) {
+		free (h->old_buckets);
+		h->old_buckets = NULL;
+		h->old_bucket_cnt = 0;
+		h->migrate_idx = 0;
+	}
 }
 
 /* Inserts E into BUCKET (in hash table H). */
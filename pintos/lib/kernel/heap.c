@@ -0,0 +1,206 @@
+/* Binary heap.
+
+   The heap is a complete binary tree whose positions are
+   numbered from 1 at the root, level by level, so that position
+   P has children 2P and 2P + 1.  The bits of P below its most
+   significant one spell out the path from the root to P, 0 for
+   left and 1 for right.  Elements are moved by relinking them,
+   never by copying, since they are embedded in their owners.
+
+   See heap.h for basic information. */
+
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *elem_at (struct heap *, size_t);
+static void swap_with_parent (struct heap *, struct heap_elem *);
+static void sift_up (struct heap *, struct heap_elem *);
+static void sift_down (struct heap *, struct heap_elem *);
+
+/* Initializes H as an empty heap ordered by LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) {
+	ASSERT (h != NULL);
+	ASSERT (less != NULL);
+
+	h->root = NULL;
+	h->elem_cnt = 0;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+heap_push (struct heap *h, struct heap_elem *e) {
+	size_t pos = ++h->elem_cnt;
+
+	ASSERT (e != NULL);
+
+	e->left = e->right = NULL;
+	if (pos == 1) {
+		e->parent = NULL;
+		h->root = e;
+		return;
+	}
+
+	/* Link E at the first free position, then move it up. */
+	e->parent = elem_at (h, pos / 2);
+	if (pos % 2 == 0)
+		e->parent->left = e;
+	else
+		e->parent->right = e;
+	sift_up (h, e);
+}
+
+/* Removes and returns the least element of H, which must not be
+   empty. */
+struct heap_elem *
+heap_pop (struct heap *h) {
+	struct heap_elem *min = heap_min (h);
+	heap_remove (h, min);
+	return min;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e) {
+	struct heap_elem *last;
+
+	ASSERT (e != NULL);
+	ASSERT (h->elem_cnt > 0);
+
+	/* Unlink the element at the last position. */
+	last = elem_at (h, h->elem_cnt);
+	if (last->parent == NULL)
+		h->root = NULL;
+	else if (last->parent->left == last)
+		last->parent->left = NULL;
+	else
+		last->parent->right = NULL;
+	h->elem_cnt--;
+
+	if (last == e)
+		return;
+
+	/* Put LAST in E's place, then restore the heap order around
+	   it, which moves it either up or down but not both. */
+	last->parent = e->parent;
+	last->left = e->left;
+	last->right = e->right;
+	if (last->left != NULL)
+		last->left->parent = last;
+	if (last->right != NULL)
+		last->right->parent = last;
+	if (last->parent == NULL)
+		h->root = last;
+	else if (last->parent->left == e)
+		last->parent->left = last;
+	else
+		last->parent->right = last;
+
+	heap_update (h, last);
+}
+
+/* Restores the heap order after the key of E, which must be in
+   H, has changed. */
+void
+heap_update (struct heap *h, struct heap_elem *e) {
+	ASSERT (e != NULL);
+
+	if (e->parent != NULL && h->less (e, e->parent, h->aux))
+		sift_up (h, e);
+	else
+		sift_down (h, e);
+}
+
+/* Returns the least element of H, which must not be empty. */
+struct heap_elem *
+heap_min (struct heap *h) {
+	ASSERT (h->root != NULL);
+	return h->root;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (struct heap *h) {
+	return h->elem_cnt;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (struct heap *h) {
+	return h->root == NULL;
+}
+
+/* Returns the element at position POS in H, which must be
+   between 1 and the number of elements. */
+static struct heap_elem *
+elem_at (struct heap *h, size_t pos) {
+	struct heap_elem *e = h->root;
+	int bit;
+
+	ASSERT (pos >= 1 && pos <= h->elem_cnt);
+
+	for (bit = 62 - __builtin_clzll (pos); bit >= 0; bit--)
+		e = (pos >> bit) & 1 ? e->right : e->left;
+	return e;
+}
+
+/* Exchanges E with its parent in H. */
+static void
+swap_with_parent (struct heap *h, struct heap_elem *e) {
+	struct heap_elem *p = e->parent;
+	struct heap_elem *gp = p->parent;
+	struct heap_elem *e_left = e->left, *e_right = e->right;
+
+	/* P takes E's children; E takes P's, with P in its own old
+	   spot. */
+	if (p->left == e) {
+		e->left = p;
+		e->right = p->right;
+		if (e->right != NULL)
+			e->right->parent = e;
+	} else {
+		e->right = p;
+		e->left = p->left;
+		if (e->left != NULL)
+			e->left->parent = e;
+	}
+	p->left = e_left;
+	p->right = e_right;
+	if (e_left != NULL)
+		e_left->parent = p;
+	if (e_right != NULL)
+		e_right->parent = p;
+
+	p->parent = e;
+	e->parent = gp;
+	if (gp == NULL)
+		h->root = e;
+	else if (gp->left == p)
+		gp->left = e;
+	else
+		gp->right = e;
+}
+
+/* Moves E up H while it is less than its parent. */
+static void
+sift_up (struct heap *h, struct heap_elem *e) {
+	while (e->parent != NULL && h->less (e, e->parent, h->aux))
+		swap_with_parent (h, e);
+}
+
+/* Moves E down H while one of its children is less than it. */
+static void
+sift_down (struct heap *h, struct heap_elem *e) {
+	for (;;) {
+		struct heap_elem *child = e->left;
+
+		if (e->right != NULL && h->less (e->right, child, h->aux))
+			child = e->right;
+		if (child == NULL || !h->less (child, e, h->aux))
+			break;
+		swap_with_parent (h, child);
+	}
+}
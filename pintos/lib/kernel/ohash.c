@@ -0,0 +1,403 @@
+/* Open-addressing hash table.
+
+   See ohash.h for basic information. */
+
+#include "ohash.h"
+#include "../debug.h"
+#include <string.h>
+#include "threads/malloc.h"
+
+/* Slots are probed in aligned groups of GROUP_SIZE, whose
+   control bytes are loaded as one 64-bit word. */
+#define GROUP_SIZE 8
+
+/* Control byte values.  A full slot holds the low 7 bits of its
+   element's hash, so the top bit tells full slots apart. */
+#define CTRL_EMPTY   0x80       /* Never used since last clear. */
+#define CTRL_DELETED 0xfe       /* Element deleted, keep probing. */
+
+/* Every byte of a control word set to 0x01 and to 0x80. */
+#define LSBS 0x0101010101010101ULL
+#define MSBS 0x8080808080808080ULL
+
+/* Largest load factor, as a fraction of slot_cnt. */
+#define MAX_LOAD_NUM 7
+#define MAX_LOAD_DEN 8
+
+/* Returned by find_slot() when no equal element exists. */
+#define NO_SLOT ((size_t) -1)
+
+static size_t find_slot (struct ohash *, struct hash_elem *, uint64_t);
+static size_t find_free (struct ohash *, uint64_t);
+static void insert_slot (struct ohash *, struct hash_elem *, uint64_t);
+static void remove_slot (struct ohash *, size_t);
+static bool resize (struct ohash *, size_t);
+static void grow (struct ohash *);
+
+/* Initializes hash table H to compute hash values using HASH and
+   compare hash elements using LESS, given auxiliary data AUX. */
+bool
+ohash_init (struct ohash *h,
+		hash_hash_func *hash, hash_less_func *less, void *aux) {
+	h->elem_cnt = 0;
+	h->slot_cnt = 0;
+	h->growth_left = 0;
+	h->ctrl = NULL;
+	h->slots = NULL;
+	h->hash = hash;
+	h->less = less;
+	h->aux = aux;
+
+	return resize (h, GROUP_SIZE);
+}
+
+/* Makes room in H for at least CNT elements, so that inserting
+   up to that many elements never has to rehash.  Returns false
+   if memory could not be allocated. */
+bool
+ohash_reserve (struct ohash *h, size_t cnt) {
+	size_t slot_cnt = h->slot_cnt;
+
+	while (cnt > slot_cnt / MAX_LOAD_DEN * MAX_LOAD_NUM)
+		slot_cnt *= 2;
+	return slot_cnt == h->slot_cnt || resize (h, slot_cnt);
+}
+
+/* Removes all the elements from H.  The slot array keeps its
+   size.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the hash.  DESTRUCTOR may, if appropriate, deallocate the
+   memory used by the hash element.  However, modifying hash
+   table H while ohash_clear() is running, using any of the
+   functions ohash_clear(), ohash_destroy(), ohash_insert(),
+   ohash_replace(), or ohash_delete(), yields undefined behavior,
+   whether done in DESTRUCTOR or elsewhere. */
+void
+ohash_clear (struct ohash *h, hash_action_func *destructor) {
+	if (destructor != NULL)
+		ohash_apply (h, destructor);
+
+	memset (h->ctrl, CTRL_EMPTY, h->slot_cnt);
+	h->elem_cnt = 0;
+	h->growth_left = h->slot_cnt / MAX_LOAD_DEN * MAX_LOAD_NUM;
+}
+
+/* Destroys hash table H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the hash, as in ohash_clear(). */
+void
+ohash_destroy (struct ohash *h, hash_action_func *destructor) {
+	if (destructor != NULL)
+		ohash_apply (h, destructor);
+	free (h->ctrl);
+}
+
+/* Inserts NEW into hash table H and returns a null pointer, if
+   no equal element is already in the table.
+   If an equal element is already in the table, returns it
+   without inserting NEW. */
+struct hash_elem *
+ohash_insert (struct ohash *h, struct hash_elem *new) {
+	uint64_t hash = h->hash (new, h->aux);
+	size_t slot = find_slot (h, new, hash);
+
+	if (slot != NO_SLOT)
+		return h->slots[slot];
+
+	insert_slot (h, new, hash);
+	return NULL;
+}
+
+/* Inserts NEW into hash table H, replacing any equal element
+   already in the table, which is returned. */
+struct hash_elem *
+ohash_replace (struct ohash *h, struct hash_elem *new) {
+	uint64_t hash = h->hash (new, h->aux);
+	size_t slot = find_slot (h, new, hash);
+	struct hash_elem *old;
+
+	if (slot == NO_SLOT) {
+		insert_slot (h, new, hash);
+		return NULL;
+	}
+
+	/* Equal elements hash alike, so the control byte stays. */
+	old = h->slots[slot];
+	h->slots[slot] = new;
+	return old;
+}
+
+/* Finds and returns an element equal to E in hash table H, or a
+   null pointer if no equal element exists in the table. */
+struct hash_elem *
+ohash_find (struct ohash *h, struct hash_elem *e) {
+	size_t slot = find_slot (h, e, h->hash (e, h->aux));
+	return slot != NO_SLOT ? h->slots[slot] : NULL;
+}
+
+/* Finds, removes, and returns an element equal to E in hash
+   table H.  Returns a null pointer if no equal element existed
+   in the table.  The table never shrinks.
+
+   If the elements of the hash table are dynamically allocated,
+   or own resources that are, then it is the caller's
+   responsibility to deallocate them. */
+struct hash_elem *
+ohash_delete (struct ohash *h, struct hash_elem *e) {
+	size_t slot = find_slot (h, e, h->hash (e, h->aux));
+	struct hash_elem *found;
+
+	if (slot == NO_SLOT)
+		return NULL;
+
+	found = h->slots[slot];
+	remove_slot (h, slot);
+	return found;
+}
+
+/* Calls ACTION for each element in hash table H in arbitrary
+   order.
+   Modifying hash table H while ohash_apply() is running, using
+   any of the functions ohash_clear(), ohash_destroy(),
+   ohash_insert(), ohash_replace(), or ohash_delete(), yields
+   undefined behavior, whether done from ACTION or elsewhere. */
+void
+ohash_apply (struct ohash *h, hash_action_func *action) {
+	size_t i;
+
+	ASSERT (action != NULL);
+
+	for (i = 0; i < h->slot_cnt; i++)
+		if (!(h->ctrl[i] & 0x80))
+			action (h->slots[i], h->aux);
+}
+
+/* Initializes I for iterating hash table H, with the same idiom
+   as hash_first().
+
+   Modifying hash table H during iteration, using any of the
+   functions ohash_clear(), ohash_destroy(), ohash_insert(),
+   ohash_replace(), or ohash_delete(), invalidates all
+   iterators. */
+void
+ohash_first (struct ohash_iterator *i, struct ohash *h) {
+	ASSERT (i != NULL);
+	ASSERT (h != NULL);
+
+	i->hash = h;
+	i->slot = (size_t) -1;
+	i->elem = NULL;
+}
+
+/* Advances I to the next element in the hash table and returns
+   it.  Returns a null pointer if no elements are left.  Elements
+   are returned in arbitrary order. */
+struct hash_elem *
+ohash_next (struct ohash_iterator *i) {
+	struct ohash *h;
+
+	ASSERT (i != NULL);
+
+	h = i->hash;
+	i->elem = NULL;
+	while (++i->slot < h->slot_cnt)
+		if (!(h->ctrl[i->slot] & 0x80)) {
+			i->elem = h->slots[i->slot];
+			break;
+		}
+
+	return i->elem;
+}
+
+/* Returns the current element in the hash table iteration, or a
+   null pointer at the end of the table.  Undefined behavior
+   after calling ohash_first() but before ohash_next(). */
+struct hash_elem *
+ohash_cur (struct ohash_iterator *i) {
+	return i->elem;
+}
+
+/* Returns the number of elements in H. */
+size_t
+ohash_size (struct ohash *h) {
+	return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+ohash_empty (struct ohash *h) {
+	return h->elem_cnt == 0;
+}
+
+/* Returns the control byte that tags an element with HASH. */
+static inline uint8_t
+hash_tag (uint64_t hash) {
+	return hash & 0x7f;
+}
+
+/* Returns the control word of group G in H. */
+static inline uint64_t
+group_load (const struct ohash *h, size_t g) {
+	return *(const uint64_t *) (h->ctrl + g * GROUP_SIZE);
+}
+
+/* Returns a mask with the top bit set in each byte of control
+   word W that equals TAG.  May rarely report a false match,
+   which the caller's comparison weeds out. */
+static inline uint64_t
+match_tag (uint64_t w, uint8_t tag) {
+	uint64_t x = w ^ (LSBS * tag);
+	return (x - LSBS) & ~x & MSBS;
+}
+
+/* Returns a mask with the top bit set in each byte of control
+   word W that is CTRL_EMPTY. */
+static inline uint64_t
+match_empty (uint64_t w) {
+	return w & (~w << 6) & MSBS;
+}
+
+/* Returns a mask with the top bit set in each byte of control
+   word W that is CTRL_EMPTY or CTRL_DELETED. */
+static inline uint64_t
+match_free (uint64_t w) {
+	return w & (~w << 7) & MSBS;
+}
+
+/* Returns the slot in group G named by the lowest bit of MASK. */
+static inline size_t
+mask_slot (size_t g, uint64_t mask) {
+	return g * GROUP_SIZE + __builtin_ctzll (mask) / 8;
+}
+
+/* Probes H for a slot holding an element equal to E, which has
+   hash value HASH.  Groups are visited in triangular order,
+   which covers every group of a power-of-2 table.  The search
+   stops at the first group with an empty slot: an element is
+   only ever placed past groups that had no free slot. */
+static size_t
+find_slot (struct ohash *h, struct hash_elem *e, uint64_t hash) {
+	size_t mask = h->slot_cnt / GROUP_SIZE - 1;
+	size_t g = (hash >> 7) & mask;
+	size_t i;
+
+	for (i = 0; i <= mask; i++) {
+		uint64_t w = group_load (h, g);
+		uint64_t m;
+
+		for (m = match_tag (w, hash_tag (hash)); m != 0; m &= m - 1) {
+			size_t slot = mask_slot (g, m);
+			struct hash_elem *hi = h->slots[slot];
+			if (!h->less (hi, e, h->aux) && !h->less (e, hi, h->aux))
+				return slot;
+		}
+		if (match_empty (w) != 0)
+			break;
+		g = (g + i + 1) & mask;
+	}
+	return NO_SLOT;
+}
+
+/* Returns the first empty or deleted slot on the probe sequence
+   for HASH in H.  H must have at least one such slot. */
+static size_t
+find_free (struct ohash *h, uint64_t hash) {
+	size_t mask = h->slot_cnt / GROUP_SIZE - 1;
+	size_t g = (hash >> 7) & mask;
+	size_t i;
+
+	for (i = 0; i <= mask; i++) {
+		uint64_t m = match_free (group_load (h, g));
+		if (m != 0)
+			return mask_slot (g, m);
+		g = (g + i + 1) & mask;
+	}
+	NOT_REACHED ();
+}
+
+/* Inserts E, which has hash value HASH and is not yet in H,
+   growing H first if it has reached its load limit.  If growing
+   fails, E still goes into a free slot, at the cost of longer
+   probes; only a completely full table is fatal. */
+static void
+insert_slot (struct ohash *h, struct hash_elem *e, uint64_t hash) {
+	size_t slot;
+
+	if (h->growth_left == 0)
+		grow (h);
+	if (h->elem_cnt == h->slot_cnt)
+		PANIC ("ohash: table full and out of memory");
+
+	slot = find_free (h, hash);
+	if (h->ctrl[slot] == CTRL_EMPTY && h->growth_left > 0)
+		h->growth_left--;
+	h->ctrl[slot] = hash_tag (hash);
+	h->slots[slot] = e;
+	h->elem_cnt++;
+}
+
+/* Removes the element in SLOT from H.  If SLOT's group still has
+   an empty slot, no probe ever continued past it, so SLOT can be
+   made empty again.  Otherwise it must stay a tombstone. */
+static void
+remove_slot (struct ohash *h, size_t slot) {
+	if (match_empty (group_load (h, slot / GROUP_SIZE)) != 0) {
+		h->ctrl[slot] = CTRL_EMPTY;
+		h->growth_left++;
+	} else
+		h->ctrl[slot] = CTRL_DELETED;
+	h->elem_cnt--;
+}
+
+/* Makes room for more insertions into H.  If deleted slots make
+   up much of the load, rehashing at the same size clears them;
+   otherwise the table doubles. */
+static void
+grow (struct ohash *h) {
+	if (h->elem_cnt <= h->slot_cnt / MAX_LOAD_DEN * MAX_LOAD_NUM / 2)
+		resize (h, h->slot_cnt);
+	else
+		resize (h, h->slot_cnt * 2);
+}
+
+/* Rebuilds H with SLOT_CNT slots, a power of 2 no smaller than
+   GROUP_SIZE, moving every element into the new slot array.
+   Returns false, leaving H unchanged, if memory could not be
+   allocated. */
+static bool
+resize (struct ohash *h, size_t slot_cnt) {
+	uint8_t *old_ctrl = h->ctrl;
+	struct hash_elem **old_slots = h->slots;
+	size_t old_slot_cnt = h->slot_cnt;
+	uint8_t *ctrl;
+	size_t i;
+
+	ASSERT (slot_cnt >= GROUP_SIZE);
+	ASSERT ((slot_cnt & (slot_cnt - 1)) == 0);
+
+	/* The control bytes and the slots share one block. */
+	ctrl = malloc (slot_cnt + slot_cnt * sizeof *h->slots);
+	if (ctrl == NULL)
+		return false;
+
+	h->ctrl = ctrl;
+	h->slots = (struct hash_elem **) (ctrl + slot_cnt);
+	h->slot_cnt = slot_cnt;
+	memset (h->ctrl, CTRL_EMPTY, slot_cnt);
+	h->growth_left = slot_cnt / MAX_LOAD_DEN * MAX_LOAD_NUM - h->elem_cnt;
+
+	for (i = 0; i < old_slot_cnt; i++)
+		if (!(old_ctrl[i] & 0x80)) {
+			struct hash_elem *e = old_slots[i];
+			uint64_t hash = h->hash (e, h->aux);
+			size_t slot = find_free (h, hash);
+
+			h->ctrl[slot] = hash_tag (hash);
+			h->slots[slot] = e;
+		}
+
+	free (old_ctrl);
+	return true;
+}
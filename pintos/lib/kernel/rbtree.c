@@ -0,0 +1,418 @@
+/* Red-black tree.
+
+   The algorithms follow Cormen, Leiserson, Rivest and Stein,
+   "Introduction to Algorithms", chapter 13, with null pointers
+   standing in for the black leaves.
+
+   See rbtree.h for basic information. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static void rotate_left (struct rbtree *, struct rb_elem *);
+static void rotate_right (struct rbtree *, struct rb_elem *);
+static void insert_fixup (struct rbtree *, struct rb_elem *);
+static void remove_fixup (struct rbtree *, struct rb_elem *,
+		struct rb_elem *);
+
+/* Returns true if E is a red element.  Null leaves are black. */
+static inline bool
+is_red (const struct rb_elem *e) {
+	return e != NULL && e->red;
+}
+
+/* Returns the leftmost element of the subtree rooted at E. */
+static inline struct rb_elem *
+leftmost (struct rb_elem *e) {
+	while (e->left != NULL)
+		e = e->left;
+	return e;
+}
+
+/* Returns the rightmost element of the subtree rooted at E. */
+static inline struct rb_elem *
+rightmost (struct rb_elem *e) {
+	while (e->right != NULL)
+		e = e->right;
+	return e;
+}
+
+/* Makes NEW take OLD's place as a child of PARENT in T, or as the
+   root of T if PARENT is null. */
+static inline void
+replace_child (struct rbtree *t, struct rb_elem *parent,
+		struct rb_elem *old, struct rb_elem *new) {
+	if (parent == NULL)
+		t->root = new;
+	else if (parent->left == old)
+		parent->left = new;
+	else
+		parent->right = new;
+}
+
+/* Initializes T as an empty tree ordered by LESS, given
+   auxiliary data AUX. */
+void
+rb_init (struct rbtree *t, rb_less_func *less, void *aux) {
+	ASSERT (t != NULL);
+	ASSERT (less != NULL);
+
+	t->root = NULL;
+	t->min = NULL;
+	t->elem_cnt = 0;
+	t->less = less;
+	t->aux = aux;
+}
+
+/* Inserts E into T, after any elements equal to it. */
+void
+rb_insert (struct rbtree *t, struct rb_elem *e) {
+	struct rb_elem *parent = NULL;
+	struct rb_elem **link = &t->root;
+	bool is_min = true;
+
+	ASSERT (e != NULL);
+
+	while (*link != NULL) {
+		parent = *link;
+		if (t->less (e, parent, t->aux))
+			link = &parent->left;
+		else {
+			link = &parent->right;
+			is_min = false;
+		}
+	}
+
+	e->parent = parent;
+	e->left = e->right = NULL;
+	e->red = true;
+	*link = e;
+	if (is_min)
+		t->min = e;
+	t->elem_cnt++;
+
+	insert_fixup (t, e);
+}
+
+/* Removes E, which must be in T, from T. */
+void
+rb_remove (struct rbtree *t, struct rb_elem *e) {
+	struct rb_elem *child, *parent;
+	bool removed_red;
+
+	ASSERT (e != NULL);
+	ASSERT (t->elem_cnt > 0);
+
+	if (t->min == e)
+		t->min = rb_next (e);
+
+	removed_red = e->red;
+	if (e->left == NULL || e->right == NULL) {
+		/* E has at most one child, which takes its place. */
+		child = e->left != NULL ? e->left : e->right;
+		parent = e->parent;
+		replace_child (t, parent, e, child);
+		if (child != NULL)
+			child->parent = parent;
+	} else {
+		/* E's successor has no left child.  It is unlinked from
+		   its own spot and then takes E's place and color. */
+		struct rb_elem *succ = leftmost (e->right);
+
+		removed_red = succ->red;
+		child = succ->right;
+		if (succ->parent == e)
+			parent = succ;
+		else {
+			parent = succ->parent;
+			parent->left = child;
+			if (child != NULL)
+				child->parent = parent;
+			succ->right = e->right;
+			succ->right->parent = succ;
+		}
+
+		replace_child (t, e->parent, e, succ);
+		succ->parent = e->parent;
+		succ->left = e->left;
+		succ->left->parent = succ;
+		succ->red = e->red;
+	}
+	t->elem_cnt--;
+
+	if (!removed_red)
+		remove_fixup (t, child, parent);
+}
+
+/* Removes and returns the least element of T, which must not be
+   empty. */
+struct rb_elem *
+rb_pop_min (struct rbtree *t) {
+	struct rb_elem *min = rb_min (t);
+	rb_remove (t, min);
+	return min;
+}
+
+/* Returns the least element of T, or rb_end() if T is empty. */
+struct rb_elem *
+rb_begin (struct rbtree *t) {
+	return t->min;
+}
+
+/* Returns the greatest element of T, or rb_end() if T is empty.
+   Used with rb_prev() to iterate in descending order. */
+struct rb_elem *
+rb_rbegin (struct rbtree *t) {
+	return t->root != NULL ? rightmost (t->root) : NULL;
+}
+
+/* Returns the end sentinel for iterating T, in either
+   direction. */
+struct rb_elem *
+rb_end (struct rbtree *t UNUSED) {
+	return NULL;
+}
+
+/* Returns the element after E in its tree, or rb_end() if E is
+   the greatest element. */
+struct rb_elem *
+rb_next (struct rb_elem *e) {
+	ASSERT (e != NULL);
+
+	if (e->right != NULL)
+		return leftmost (e->right);
+	while (e->parent != NULL && e == e->parent->right)
+		e = e->parent;
+	return e->parent;
+}
+
+/* Returns the element before E in its tree, or rb_end() if E is
+   the least element. */
+struct rb_elem *
+rb_prev (struct rb_elem *e) {
+	ASSERT (e != NULL);
+
+	if (e->left != NULL)
+		return rightmost (e->left);
+	while (e->parent != NULL && e == e->parent->left)
+		e = e->parent;
+	return e->parent;
+}
+
+/* Returns the least element of T, which must not be empty. */
+struct rb_elem *
+rb_min (struct rbtree *t) {
+	ASSERT (t->min != NULL);
+	return t->min;
+}
+
+/* Returns the greatest element of T, which must not be empty. */
+struct rb_elem *
+rb_max (struct rbtree *t) {
+	ASSERT (t->root != NULL);
+	return rightmost (t->root);
+}
+
+/* Returns the first element of T equal to KEY, or a null pointer
+   if there is none.  KEY need not be in T; it only has to be
+   something T's comparison function accepts. */
+struct rb_elem *
+rb_find (struct rbtree *t, const struct rb_elem *key) {
+	struct rb_elem *e = rb_lower_bound (t, key);
+
+	if (e != NULL && !t->less (key, e, t->aux))
+		return e;
+	return NULL;
+}
+
+/* Returns the first element of T that is not less than KEY, or
+   rb_end() if there is none.  Together with rb_upper_bound(),
+   this bounds the range of elements equal to KEY, or starts an
+   iteration over all elements from KEY up. */
+struct rb_elem *
+rb_lower_bound (struct rbtree *t, const struct rb_elem *key) {
+	struct rb_elem *e = t->root;
+	struct rb_elem *bound = NULL;
+
+	while (e != NULL)
+		if (!t->less (e, key, t->aux)) {
+			bound = e;
+			e = e->left;
+		} else
+			e = e->right;
+	return bound;
+}
+
+/* Returns the first element of T that is greater than KEY, or
+   rb_end() if there is none. */
+struct rb_elem *
+rb_upper_bound (struct rbtree *t, const struct rb_elem *key) {
+	struct rb_elem *e = t->root;
+	struct rb_elem *bound = NULL;
+
+	while (e != NULL)
+		if (t->less (key, e, t->aux)) {
+			bound = e;
+			e = e->left;
+		} else
+			e = e->right;
+	return bound;
+}
+
+/* Returns the number of elements in T. */
+size_t
+rb_size (struct rbtree *t) {
+	return t->elem_cnt;
+}
+
+/* Returns true if T is empty, false otherwise. */
+bool
+rb_empty (struct rbtree *t) {
+	return t->root == NULL;
+}
+
+/* Rotates the subtree rooted at X to the left, so that X's right
+   child takes its place and X becomes that child's left child. */
+static void
+rotate_left (struct rbtree *t, struct rb_elem *x) {
+	struct rb_elem *y = x->right;
+
+	x->right = y->left;
+	if (y->left != NULL)
+		y->left->parent = x;
+	y->parent = x->parent;
+	replace_child (t, x->parent, x, y);
+	y->left = x;
+	x->parent = y;
+}
+
+/* Rotates the subtree rooted at X to the right, the mirror image
+   of rotate_left(). */
+static void
+rotate_right (struct rbtree *t, struct rb_elem *x) {
+	struct rb_elem *y = x->left;
+
+	x->left = y->right;
+	if (y->right != NULL)
+		y->right->parent = x;
+	y->parent = x->parent;
+	replace_child (t, x->parent, x, y);
+	y->right = x;
+	x->parent = y;
+}
+
+/* Restores the red-black properties after red element E has been
+   linked into T as a leaf: no red element may have a red
+   parent. */
+static void
+insert_fixup (struct rbtree *t, struct rb_elem *e) {
+	struct rb_elem *parent;
+
+	while (is_red (parent = e->parent)) {
+		/* A red parent is never the root, so it has a parent. */
+		struct rb_elem *grandparent = parent->parent;
+
+		if (parent == grandparent->left) {
+			struct rb_elem *uncle = grandparent->right;
+
+			if (is_red (uncle)) {
+				parent->red = uncle->red = false;
+				grandparent->red = true;
+				e = grandparent;
+				continue;
+			}
+			if (e == parent->right) {
+				rotate_left (t, parent);
+				e = parent;
+				parent = e->parent;
+			}
+			parent->red = false;
+			grandparent->red = true;
+			rotate_right (t, grandparent);
+		} else {
+			struct rb_elem *uncle = grandparent->left;
+
+			if (is_red (uncle)) {
+				parent->red = uncle->red = false;
+				grandparent->red = true;
+				e = grandparent;
+				continue;
+			}
+			if (e == parent->left) {
+				rotate_right (t, parent);
+				e = parent;
+				parent = e->parent;
+			}
+			parent->red = false;
+			grandparent->red = true;
+			rotate_left (t, grandparent);
+		}
+	}
+	t->root->red = false;
+}
+
+/* Restores the red-black properties after a black element was
+   removed from T.  X, which may be null, is the element that took
+   its place and PARENT is X's parent: every path through X is one
+   black element short. */
+static void
+remove_fixup (struct rbtree *t, struct rb_elem *x, struct rb_elem *parent) {
+	while (x != t->root && !is_red (x)) {
+		/* X is short a black element, so its sibling exists. */
+		if (x == parent->left) {
+			struct rb_elem *sibling = parent->right;
+
+			if (sibling->red) {
+				sibling->red = false;
+				parent->red = true;
+				rotate_left (t, parent);
+				sibling = parent->right;
+			}
+			if (!is_red (sibling->left) && !is_red (sibling->right)) {
+				sibling->red = true;
+				x = parent;
+				parent = x->parent;
+			} else {
+				if (!is_red (sibling->right)) {
+					sibling->left->red = false;
+					sibling->red = true;
+					rotate_right (t, sibling);
+					sibling = parent->right;
+				}
+				sibling->red = parent->red;
+				parent->red = false;
+				sibling->right->red = false;
+				rotate_left (t, parent);
+				x = t->root;
+			}
+		} else {
+			struct rb_elem *sibling = parent->left;
+
+			if (sibling->red) {
+				sibling->red = false;
+				parent->red = true;
+				rotate_right (t, parent);
+				sibling = parent->left;
+			}
+			if (!is_red (sibling->left) && !is_red (sibling->right)) {
+				sibling->red = true;
+				x = parent;
+				parent = x->parent;
+			} else {
+				if (!is_red (sibling->left)) {
+					sibling->right->red = false;
+					sibling->red = true;
+					rotate_left (t, sibling);
+					sibling = parent->left;
+				}
+				sibling->red = parent->red;
+				parent->red = false;
+				sibling->left->red = false;
+				rotate_right (t, parent);
+				x = t->root;
+			}
+		}
+	}
+	if (x != NULL)
+		x->red = false;
+}
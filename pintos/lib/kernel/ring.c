@@ -0,0 +1,157 @@
+#include "ring.h"
+#include <debug.h>
+#include <string.h>
+
+/* Index accesses.  Each side reads the other side's index with
+   acquire semantics, so that it sees the bytes published with
+   it, and publishes its own index with release semantics, after
+   the bytes it covers.  On x86 these are ordinary loads and
+   stores that the compiler may not move across. */
+#define LOAD_ACQUIRE(P) __atomic_load_n (P, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(P, V) __atomic_store_n (P, V, __ATOMIC_RELEASE)
+
+/* Initializes R as an empty ring that stores its bytes in the
+   CAPACITY bytes at BUF.  CAPACITY must be a power of 2, and BUF
+   must stay allocated for as long as R is in use. */
+void
+ring_init (struct ring *r, void *buf, size_t capacity) {
+	ASSERT (r != NULL);
+	ASSERT (buf != NULL);
+	ASSERT (capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+	r->buf = buf;
+	r->mask = capacity - 1;
+	r->head = r->tail = 0;
+}
+
+/* Returns the number of bytes R can hold. */
+size_t
+ring_capacity (const struct ring *r) {
+	return r->mask + 1;
+}
+
+/* Returns the number of bytes in R.  If called by neither the
+   producer nor the consumer, the result may be stale by the time
+   it is used. */
+size_t
+ring_count (const struct ring *r) {
+	return LOAD_ACQUIRE (&r->head) - LOAD_ACQUIRE (&r->tail);
+}
+
+/* Returns the number of bytes that can be added to R. */
+size_t
+ring_space (const struct ring *r) {
+	return ring_capacity (r) - ring_count (r);
+}
+
+/* Returns true if R holds no bytes. */
+bool
+ring_empty (const struct ring *r) {
+	return ring_count (r) == 0;
+}
+
+/* Returns true if no byte can be added to R. */
+bool
+ring_full (const struct ring *r) {
+	return ring_space (r) == 0;
+}
+
+/* Adds BYTE to R.  Returns true if successful, false if R is
+   full.  Only the producer may call this function. */
+bool
+ring_putc (struct ring *r, uint8_t byte) {
+	size_t head = r->head;
+
+	if (head - LOAD_ACQUIRE (&r->tail) > r->mask)
+		return false;
+	r->buf[head & r->mask] = byte;
+	STORE_RELEASE (&r->head, head + 1);
+	return true;
+}
+
+/* Adds up to SIZE bytes from BUFFER to R, as many as fit.
+   Returns the number of bytes added.  Only the producer may call
+   this function. */
+size_t
+ring_write (struct ring *r, const void *buffer, size_t size) {
+	size_t head = r->head;
+	size_t space = ring_capacity (r) - (head - LOAD_ACQUIRE (&r->tail));
+	size_t ofs = head & r->mask;
+	size_t first;
+
+	if (size > space)
+		size = space;
+
+	/* Copy in at most two pieces: up to the end of the buffer,
+	   then from its start. */
+	first = ring_capacity (r) - ofs;
+	if (first > size)
+		first = size;
+	memcpy (r->buf + ofs, buffer, first);
+	memcpy (r->buf, (const uint8_t *) buffer + first, size - first);
+
+	STORE_RELEASE (&r->head, head + size);
+	return size;
+}
+
+/* Removes and returns the oldest byte in R, or -1 if R is empty.
+   Only the consumer may call this function. */
+int
+ring_getc (struct ring *r) {
+	size_t tail = r->tail;
+	uint8_t byte;
+
+	if (LOAD_ACQUIRE (&r->head) == tail)
+		return -1;
+	byte = r->buf[tail & r->mask];
+	STORE_RELEASE (&r->tail, tail + 1);
+	return byte;
+}
+
+/* Removes up to SIZE of the oldest bytes in R, as many as it
+   holds, into BUFFER.  Returns the number of bytes removed.  Only
+   the consumer may call this function. */
+size_t
+ring_read (struct ring *r, void *buffer, size_t size) {
+	size_t tail = r->tail;
+	size_t count = LOAD_ACQUIRE (&r->head) - tail;
+	size_t ofs = tail & r->mask;
+	size_t first;
+
+	if (size > count)
+		size = count;
+
+	first = ring_capacity (r) - ofs;
+	if (first > size)
+		first = size;
+	memcpy (buffer, r->buf + ofs, first);
+	memcpy ((uint8_t *) buffer + first, r->buf, size - first);
+
+	STORE_RELEASE (&r->tail, tail + size);
+	return size;
+}
+
+/* Copies up to SIZE of the bytes most recently added to R into
+   BUFFER, oldest first, whether or not they have been removed
+   yet, and returns the number of bytes copied.  This is at most
+   R's capacity, since older bytes have been overwritten.  The
+   producer must not run at the same time. */
+size_t
+ring_recent (const struct ring *r, void *buffer, size_t size) {
+	size_t head = r->head;
+	size_t start, ofs, first;
+
+	if (size > ring_capacity (r))
+		size = ring_capacity (r);
+	if (size > head)
+		size = head;
+
+	start = head - size;
+	ofs = start & r->mask;
+	first = ring_capacity (r) - ofs;
+	if (first > size)
+		first = size;
+	memcpy (buffer, r->buf + ofs, first);
+	memcpy ((uint8_t *) buffer + first, r->buf, size - first);
+	return size;
+}
@@ -2,4 +2,8 @@ lib/kernel_SRC  = lib/kernel/debug.c	# Debug helpers.
 lib/kernel_SRC += lib/kernel/list.c	# Doubly-linked lists.
 lib/kernel_SRC += lib/kernel/bitmap.c	# Bitmaps.
 lib/kernel_SRC += lib/kernel/hash.c	# Hash tables.
+lib/kernel_SRC += lib/kernel/ohash.c	# Open-addressing hash tables.
+lib/kernel_SRC += lib/kernel/rbtree.c	# Red-black trees.
+lib/kernel_SRC += lib/kernel/heap.c	# Binary heaps.
+lib/kernel_SRC += lib/kernel/ring.c	# Lock-free ring buffers.
 lib/kernel_SRC += lib/kernel/console.c	# printf(), putchar().
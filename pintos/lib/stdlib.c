@@ -3,6 +3,8 @@
 #include <random.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 /* Converts a string representation of a signed decimal integer
    in S into an `int', which is returned. */
@@ -52,7 +54,7 @@ compare_thunk (const void *a, const void *b, void *aux)
    using COMPARE.  When COMPARE is passed a pair of elements A
    and B, respectively, it must return a strcmp()-type result,
    i.e. less than zero if A < B, zero if A == B, greater than
-   zero if A > B.  Runs in O(n lg n) time and O(1) space in
+   zero if A > B.  Runs in O(n lg n) time and O(lg n) space in
    CNT. */
 void
 qsort (void *array, size_t cnt, size_t size,
@@ -61,13 +63,33 @@ qsort (void *array, size_t cnt, size_t size,
   sort (array, cnt, size, compare_thunk, &compare);
 }
 
-/* Swaps elements with 1-based indexes A_IDX and B_IDX in ARRAY
-   with elements of SIZE bytes each. */
+/* Sorting.
+
+   sort() is an introsort: a quicksort that picks its pivot as the
+   median of three elements, finishes small partitions with
+   insertion sort, and falls back to heapsort for a partition
+   whose recursion runs too deep, which bounds the worst case at
+   O(n lg n).  Most of the time goes into comparing and swapping
+   elements, so elements of 4, 8, and 16 bytes, or any multiple of
+   8 bytes, are swapped a word at a time when they are suitably
+   aligned. */
+
+/* Partitions of at most this many elements are insertion
+   sorted. */
+#define INSERTION_CUTOFF 12
+
+/* Compares A and B, strcmp()-style. */
+typedef int compare_func (const void *a, const void *b, void *aux);
+
+/* Exchanges the SIZE-byte elements at A and B. */
+typedef void swap_func (void *a, void *b, size_t size);
+
+/* Swaps SIZE-byte elements A and B a byte at a time. */
 static void
-do_swap (unsigned char *array, size_t a_idx, size_t b_idx, size_t size)
+swap_bytes (void *a_, void *b_, size_t size)
 {
-  unsigned char *a = array + (a_idx - 1) * size;
-  unsigned char *b = array + (b_idx - 1) * size;
+  unsigned char *a = a_;
+  unsigned char *b = b_;
   size_t i;
 
   for (i = 0; i < size; i++)
@@ -78,25 +100,83 @@ do_swap (unsigned char *array, size_t a_idx, size_t b_idx, size_t size)
     }
 }
 
-/* Compares elements with 1-based indexes A_IDX and B_IDX in
-   ARRAY with elements of SIZE bytes each, using COMPARE to
-   compare elements, passing AUX as auxiliary data, and returns a
-   strcmp()-type result. */
-static int
-do_compare (unsigned char *array, size_t a_idx, size_t b_idx, size_t size,
-            int (*compare) (const void *, const void *, void *aux),
-            void *aux) 
+/* Swaps SIZE-byte elements A and B a 64-bit word at a time.
+   SIZE must be a multiple of 8. */
+static void
+swap_words (void *a_, void *b_, size_t size)
+{
+  uint64_t *a = a_;
+  uint64_t *b = b_;
+  size_t i;
+
+  for (i = 0; i < size / sizeof *a; i++)
+    {
+      uint64_t t = a[i];
+      a[i] = b[i];
+      b[i] = t;
+    }
+}
+
+/* Swaps 4-byte elements A and B. */
+static void
+swap_4 (void *a_, void *b_, size_t size UNUSED)
+{
+  uint32_t *a = a_;
+  uint32_t *b = b_;
+  uint32_t t = *a;
+
+  *a = *b;
+  *b = t;
+}
+
+/* Swaps 8-byte elements A and B. */
+static void
+swap_8 (void *a_, void *b_, size_t size UNUSED)
 {
-  return compare (array + (a_idx - 1) * size, array + (b_idx - 1) * size, aux);
+  uint64_t *a = a_;
+  uint64_t *b = b_;
+  uint64_t t = *a;
+
+  *a = *b;
+  *b = t;
+}
+
+/* Swaps 16-byte elements A and B. */
+static void
+swap_16 (void *a_, void *b_, size_t size UNUSED)
+{
+  uint64_t *a = a_;
+  uint64_t *b = b_;
+  uint64_t t0 = a[0], t1 = a[1];
+
+  a[0] = b[0];
+  a[1] = b[1];
+  b[0] = t0;
+  b[1] = t1;
+}
+
+/* Returns the fastest swap function that works for elements of
+   SIZE bytes in ARRAY. */
+static swap_func *
+choose_swap (const void *array, size_t size)
+{
+  uintptr_t align = (uintptr_t) array | size;
+
+  if (align % 8 == 0)
+    return size == 8 ? swap_8 : size == 16 ? swap_16 : swap_words;
+  else if (size == 4 && align % 4 == 0)
+    return swap_4;
+  else
+    return swap_bytes;
 }
 
 /* "Float down" the element with 1-based index I in ARRAY of CNT
    elements of SIZE bytes each, using COMPARE to compare
-   elements, passing AUX as auxiliary data. */
+   elements, passing AUX as auxiliary data, and SWAP to exchange
+   them. */
 static void
 heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
-         int (*compare) (const void *, const void *, void *aux),
-         void *aux) 
+         compare_func *compare, void *aux, swap_func *swap) 
 {
   for (;;) 
     {
@@ -105,10 +185,13 @@ heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
       size_t left = 2 * i;
       size_t right = 2 * i + 1;
       size_t max = i;
-      if (left <= cnt && do_compare (array, left, max, size, compare, aux) > 0)
+      if (left <= cnt
+          && compare (array + (left - 1) * size,
+                      array + (max - 1) * size, aux) > 0)
         max = left;
       if (right <= cnt
-          && do_compare (array, right, max, size, compare, aux) > 0) 
+          && compare (array + (right - 1) * size,
+                      array + (max - 1) * size, aux) > 0) 
         max = right;
 
       /* If the maximum value is already in element I, we're
@@ -117,40 +200,225 @@ heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
         break;
 
       /* Swap and continue down the heap. */
-      do_swap (array, i, max, size);
+      swap (array + (i - 1) * size, array + (max - 1) * size, size);
       i = max;
     }
 }
 
+/* Heapsorts ARRAY, which contains CNT elements of SIZE bytes
+   each. */
+static void
+heap_sort (unsigned char *array, size_t cnt, size_t size,
+           compare_func *compare, void *aux, swap_func *swap)
+{
+  size_t i;
+
+  /* Build a heap. */
+  for (i = cnt / 2; i > 0; i--)
+    heapify (array, i, cnt, size, compare, aux, swap);
+
+  /* Sort the heap. */
+  for (i = cnt; i > 1; i--) 
+    {
+      swap (array, array + (i - 1) * size, size);
+      heapify (array, 1, i - 1, size, compare, aux, swap); 
+    }
+}
+
+/* Insertion sorts ARRAY, which contains CNT elements of SIZE
+   bytes each. */
+static void
+insertion_sort (unsigned char *array, size_t cnt, size_t size,
+                compare_func *compare, void *aux, swap_func *swap)
+{
+  unsigned char *end = array + cnt * size;
+  unsigned char *p, *q;
+
+  for (p = array + size; p < end; p += size)
+    for (q = p; q > array && compare (q - size, q, aux) > 0; q -= size)
+      swap (q - size, q, size);
+}
+
+/* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
+   by quicksort, switching to heapsort once DEPTH levels of
+   partitioning have not sufficed. */
+static void
+intro_sort (unsigned char *array, size_t cnt, size_t size,
+            compare_func *compare, void *aux, swap_func *swap, int depth)
+{
+  while (cnt > INSERTION_CUTOFF)
+    {
+      unsigned char *lo = array;
+      unsigned char *mid = array + cnt / 2 * size;
+      unsigned char *hi = array + (cnt - 1) * size;
+      unsigned char *i, *j;
+      size_t left_cnt, right_cnt;
+
+      if (depth-- == 0)
+        {
+          heap_sort (array, cnt, size, compare, aux, swap);
+          return;
+        }
+
+      /* Order the first, middle, and last elements, then use the
+         median as pivot, moved to the front.  The last element
+         is then no less than the pivot, which keeps the upward
+         scan below in bounds. */
+      if (compare (mid, lo, aux) < 0)
+        swap (mid, lo, size);
+      if (compare (hi, mid, aux) < 0)
+        {
+          swap (hi, mid, size);
+          if (compare (mid, lo, aux) < 0)
+            swap (mid, lo, size);
+        }
+      swap (array, mid, size);
+
+      /* Partition around the pivot.  Both scans stop at elements
+         equal to the pivot, so that runs of equal elements split
+         evenly. */
+      i = array;
+      j = array + cnt * size;
+      for (;;)
+        {
+          do
+            i += size;
+          while (compare (i, array, aux) < 0);
+          do
+            j -= size;
+          while (compare (array, j, aux) < 0);
+          if (i >= j)
+            break;
+          swap (i, j, size);
+        }
+      swap (array, j, size);
+
+      /* Recurse into the smaller side and loop on the larger, so
+         that the stack stays O(lg n) deep. */
+      left_cnt = (j - array) / size;
+      right_cnt = cnt - left_cnt - 1;
+      if (left_cnt < right_cnt)
+        {
+          intro_sort (array, left_cnt, size, compare, aux, swap, depth);
+          array = j + size;
+          cnt = right_cnt;
+        }
+      else
+        {
+          intro_sort (j + size, right_cnt, size, compare, aux, swap, depth);
+          cnt = left_cnt;
+        }
+    }
+
+  insertion_sort (array, cnt, size, compare, aux, swap);
+}
+
 /* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
    using COMPARE to compare elements, passing AUX as auxiliary
    data.  When COMPARE is passed a pair of elements A and B,
    respectively, it must return a strcmp()-type result, i.e. less
    than zero if A < B, zero if A == B, greater than zero if A >
-   B.  Runs in O(n lg n) time and O(1) space in CNT. */
+   B.  Runs in O(n lg n) time and O(lg n) space in CNT. */
 void
 sort (void *array, size_t cnt, size_t size,
       int (*compare) (const void *, const void *, void *aux),
       void *aux) 
 {
-  size_t i;
+  int depth;
+  size_t n;
 
   ASSERT (array != NULL || cnt == 0);
   ASSERT (compare != NULL);
   ASSERT (size > 0);
 
-  /* Build a heap. */
-  for (i = cnt / 2; i > 0; i--)
-    heapify (array, i, cnt, size, compare, aux);
+  /* Allow 2 lg CNT levels of partitioning. */
+  depth = 0;
+  for (n = cnt; n > 1; n /= 2)
+    depth += 2;
 
-  /* Sort the heap. */
-  for (i = cnt; i > 1; i--) 
+  intro_sort (array, cnt, size, compare, aux, choose_swap (array, size),
+              depth);
+}
+
+/* Sorts the CNT bytes in ARRAY into ascending order by counting
+   them.  Runs in O(n) time and O(1) space in CNT.  CNT may not
+   exceed UINT32_MAX. */
+void
+radix_sort_u8 (uint8_t *array, size_t cnt)
+{
+  uint32_t histogram[256];
+  size_t i;
+  int value;
+
+  ASSERT (array != NULL || cnt == 0);
+  ASSERT (cnt <= UINT32_MAX);
+
+  for (i = 0; i < 256; i++)
+    histogram[i] = 0;
+  for (i = 0; i < cnt; i++)
+    histogram[array[i]]++;
+
+  for (value = 0; value < 256; value++)
     {
-      do_swap (array, 1, i, size);
-      heapify (array, 1, i - 1, size, compare, aux); 
+      memset (array, value, histogram[value]);
+      array += histogram[value];
     }
 }
 
+/* Sorts the CNT integers in ARRAY into ascending order, a byte
+   of the key at a time, least significant first.  TMP must have
+   room for CNT integers; its contents are destroyed.  Runs in
+   O(n) time in CNT, which may not exceed UINT32_MAX.
+
+   The digit counts take 1 kB of stack, recounted for each pass,
+   so that this is safe to call on a kernel thread's stack. */
+void
+radix_sort_u32 (uint32_t *array, uint32_t *tmp, size_t cnt)
+{
+  uint32_t count[256];
+  uint32_t *src = array, *dst = tmp;
+  size_t i;
+  int pass;
+
+  ASSERT (array != NULL || cnt == 0);
+  ASSERT (tmp != NULL || cnt == 0);
+  ASSERT (cnt <= UINT32_MAX);
+
+  for (pass = 0; pass < 4; pass++)
+    {
+      int shift = pass * 8;
+      uint32_t ofs, c;
+      int digit;
+      uint32_t *t;
+
+      memset (count, 0, sizeof count);
+      for (i = 0; i < cnt; i++)
+        count[(src[i] >> shift) & 0xff]++;
+
+      /* A digit that is the same in every key cannot reorder
+         anything. */
+      if (cnt == 0 || count[(src[0] >> shift) & 0xff] == cnt)
+        continue;
+
+      /* Turn counts into starting offsets, then scatter. */
+      for (digit = 0, ofs = 0; digit < 256; digit++)
+        {
+          c = count[digit];
+          count[digit] = ofs;
+          ofs += c;
+        }
+      for (i = 0; i < cnt; i++)
+        dst[count[(src[i] >> shift) & 0xff]++] = src[i];
+
+      t = src;
+      src = dst;
+      dst = t;
+    }
+
+  if (src != array)
+    memcpy (array, src, cnt * sizeof *array);
+}
+
 /* Searches ARRAY, which contains CNT elements of SIZE bytes
    each, for the given KEY.  Returns a match is found, otherwise
    a null pointer.  If there are multiple matches, returns an
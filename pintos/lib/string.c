@@ -1,5 +1,114 @@
 #include <string.h>
 #include <debug.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Size of the pages handled by copy_page() and clear_page().
+   Must match PGSIZE in threads/vaddr.h. */
+#define PAGE_SIZE 4096
+
+/* Blocks shorter than this are copied with plain word loops,
+   because the startup cost of a string instruction outweighs
+   its throughput. */
+#define REP_THRESHOLD 64
+
+/* A machine word that may be unaligned and may alias any other
+   type, so that the word loops below stay correct when the
+   compiler optimizes. */
+typedef uint64_t __attribute__ ((__may_alias__, __aligned__ (1))) word_t;
+
+/* Replicates byte B into every byte of a word. */
+#define WORD_REPEAT(B) ((uint64_t) (unsigned char) (B) * 0x0101010101010101ull)
+
+/* Nonzero if some byte of word X is zero.  The lowest set bit of
+   the result is the top bit of the lowest zero byte in X; bits
+   above it may be set spuriously, so only the lowest set bit is
+   meaningful (x86 is little-endian, so that is the first zero
+   byte in memory order). */
+#define HAS_ZERO(X) (((X) - WORD_REPEAT (0x01)) & ~(X) & WORD_REPEAT (0x80))
+
+/* Returns the index within its word of the first byte flagged by
+   a nonzero HAS_ZERO result M. */
+#define ZERO_INDEX(M) ((size_t) __builtin_ctzll (M) / 8)
+
+/* True if P is aligned on a word boundary.  An aligned word never
+   straddles a page boundary, so reading one is safe whenever its
+   first byte is readable, even if the string ends earlier. */
+#define WORD_ALIGNED(P) (((uintptr_t) (P) & 7) == 0)
+
+/* True if an unaligned word read at P stays within P's page. */
+#define WORD_IN_PAGE(P) (((uintptr_t) (P) & (PAGE_SIZE - 1)) <= PAGE_SIZE - 8)
+
+/* Whether the CPU advertises Enhanced REP MOVSB/STOSB (ERMS),
+   in which case a single `rep movsb' or `rep stosb' is at least
+   as fast as the quadword variants: 1 if so, 0 if not, -1 if not
+   yet probed. */
+static int erms = -1;
+
+/* Returns true if the CPU supports ERMS.  See [IA32-v2a]
+   "CPUID", leaf 07H, EBX bit 9. */
+static bool
+has_erms (void) {
+	if (erms < 0) {
+		uint32_t max_leaf, ebx = 0, ecx = 0, edx;
+
+		asm volatile ("cpuid"
+				: "=a" (max_leaf), "=b" (ebx), "=c" (ecx), "=d" (edx)
+				: "a" (0));
+		if (max_leaf >= 7)
+			asm volatile ("cpuid"
+					: "=a" (max_leaf), "=b" (ebx), "=c" (ecx), "=d" (edx)
+					: "a" (7), "c" (0));
+		else
+			ebx = 0;
+		erms = (ebx >> 9) & 1;
+	}
+	return erms;
+}
+
+/* Copies SIZE bytes forward from SRC to DST using string
+   instructions. */
+static inline void
+rep_copy (unsigned char *dst, const unsigned char *src, size_t size) {
+	if (has_erms ())
+		asm volatile ("rep movsb"
+				: "+D" (dst), "+S" (src), "+c" (size) : : "memory");
+	else {
+		size_t words = size / 8;
+		size_t tail = size % 8;
+		asm volatile ("rep movsq"
+				: "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+		asm volatile ("rep movsb"
+				: "+D" (dst), "+S" (src), "+c" (tail) : : "memory");
+	}
+}
+
+/* Copies SIZE bytes forward from SRC to DST a word at a time.
+   Each word is loaded before it is stored, so this is also safe
+   for overlapping blocks when DST < SRC. */
+static inline void
+word_copy_forward (unsigned char *dst, const unsigned char *src, size_t size) {
+	for (; size >= 8; size -= 8, dst += 8, src += 8)
+		*(word_t *) dst = *(const word_t *) src;
+	while (size-- > 0)
+		*dst++ = *src++;
+}
+
+/* Copies SIZE bytes from SRC to DST a word at a time, starting
+   from the end.  Safe for overlapping blocks when DST > SRC. */
+static inline void
+word_copy_backward (unsigned char *dst, const unsigned char *src, size_t size) {
+	dst += size;
+	src += size;
+	for (; size >= 8; size -= 8) {
+		dst -= 8;
+		src -= 8;
+		*(word_t *) dst = *(const word_t *) src;
+	}
+	while (size-- > 0)
+		*--dst = *--src;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -11,8 +120,10 @@ memcpy (void *dst_, const void *src_, size_t size) {
 	ASSERT (dst != NULL || size == 0);
 	ASSERT (src != NULL || size == 0);
 
-	while (size-- > 0)
-		*dst++ = *src++;
+	if (size < REP_THRESHOLD)
+		word_copy_forward (dst, src, size);
+	else
+		rep_copy (dst, src, size);
 
 	return dst_;
 }
@@ -27,17 +138,17 @@ memmove (void *dst_, const void *src_, size_t size) {
 	ASSERT (dst != NULL || size == 0);
 	ASSERT (src != NULL || size == 0);
 
-	if (dst < src) {
-		while (size-- > 0)
-			*dst++ = *src++;
-	} else {
-		dst += size;
-		src += size;
-		while (size-- > 0)
-			*--dst = *--src;
-	}
+	if (dst <= src || dst >= src + size) {
+		/* A forward copy never overwrites source bytes that have
+		   not been read yet. */
+		if (size < REP_THRESHOLD)
+			word_copy_forward (dst, src, size);
+		else
+			rep_copy (dst, src, size);
+	} else
+		word_copy_backward (dst, src, size);
 
-	return dst;
+	return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -52,6 +163,15 @@ memcmp (const void *a_, const void *b_, size_t size) {
 	ASSERT (a != NULL || size == 0);
 	ASSERT (b != NULL || size == 0);
 
+	/* Compare a word at a time.  Byte-swapping the first unequal
+	   pair of words makes their numeric order match the order of
+	   their first differing byte. */
+	for (; size >= 8; size -= 8, a += 8, b += 8) {
+		uint64_t wa = *(const word_t *) a;
+		uint64_t wb = *(const word_t *) b;
+		if (wa != wb)
+			return __builtin_bswap64 (wa) > __builtin_bswap64 (wb) ? +1 : -1;
+	}
 	for (; size-- > 0; a++, b++)
 		if (*a != *b)
 			return *a > *b ? +1 : -1;
@@ -71,7 +191,22 @@ strcmp (const char *a_, const char *b_) {
 	ASSERT (a != NULL);
 	ASSERT (b != NULL);
 
-	while (*a != '\0' && *a == *b) {
+	/* Align A byte by byte, then compare a word at a time for as
+	   long as the words are equal and contain no null terminator.
+	   B's word may be unaligned, so it is only read whole when it
+	   does not cross into the next page. */
+	for (;;) {
+		if (WORD_ALIGNED (a) && WORD_IN_PAGE (b)) {
+			uint64_t wa = *(const word_t *) a;
+			uint64_t wb = *(const word_t *) b;
+			if (wa == wb && !HAS_ZERO (wa)) {
+				a += 8;
+				b += 8;
+				continue;
+			}
+		}
+		if (*a == '\0' || *a != *b)
+			break;
 		a++;
 		b++;
 	}
@@ -106,6 +241,23 @@ strchr (const char *string, int c_) {
 
 	ASSERT (string);
 
+	/* Check byte by byte up to a word boundary. */
+	for (; !WORD_ALIGNED (string); string++)
+		if (*string == c)
+			return (char *) string;
+		else if (*string == '\0')
+			return NULL;
+
+	/* Skip whole words containing neither C nor a null byte. */
+	uint64_t pattern = WORD_REPEAT (c);
+	for (;;) {
+		uint64_t w = *(const word_t *) string;
+		if (HAS_ZERO (w) | HAS_ZERO (w ^ pattern))
+			break;
+		string += 8;
+	}
+
+	/* One of the next 8 bytes is C or the terminator. */
 	for (;;)
 		if (*string == c)
 			return (char *) string;
@@ -168,16 +320,36 @@ strspn (const char *string, const char *skip) {
    within HAYSTACK. */
 char *
 strstr (const char *haystack, const char *needle) {
-	size_t haystack_len = strlen (haystack);
-	size_t needle_len = strlen (needle);
-
-	if (haystack_len >= needle_len) {
-		size_t i;
-
-		for (i = 0; i <= haystack_len - needle_len; i++)
-			if (!memcmp (haystack + i, needle, needle_len))
-				return (char *) haystack + i;
-	}
+	size_t haystack_len, needle_len;
+
+	/* Empty and single-character needles need no search table. */
+	if (needle[0] == '\0')
+		return (char *) haystack;
+	if (needle[1] == '\0')
+		return strchr (haystack, needle[0]);
+
+	haystack_len = strlen (haystack);
+	needle_len = strlen (needle);
+	if (haystack_len < needle_len)
+		return NULL;
+
+	/* Boyer-Moore-Horspool.  SHIFT[C] is how far the needle may
+	   advance when the haystack byte aligned with its last byte is
+	   C.  Shifts are capped at UCHAR_MAX to keep the table small
+	   enough for a kernel stack; a smaller shift is always safe. */
+	const unsigned char *h = (const unsigned char *) haystack;
+	const unsigned char *n = (const unsigned char *) needle;
+	size_t last = needle_len - 1;
+	unsigned char shift[UCHAR_MAX + 1];
+	size_t i;
+
+	memset (shift, needle_len < UCHAR_MAX ? needle_len : UCHAR_MAX, sizeof shift);
+	for (i = last > UCHAR_MAX ? last - UCHAR_MAX : 0; i < last; i++)
+		shift[n[i]] = last - i;
+
+	for (i = 0; i <= haystack_len - needle_len; i += shift[h[i + last]])
+		if (h[i + last] == n[last] && !memcmp (h + i, n, last))
+			return (char *) h + i;
 
 	return NULL;
 }
@@ -260,12 +432,51 @@ memset (void *dst_, int value, size_t size) {
 
 	ASSERT (dst != NULL || size == 0);
 
-	while (size-- > 0)
-		*dst++ = value;
+	if (size < REP_THRESHOLD) {
+		uint64_t pattern = WORD_REPEAT (value);
+		for (; size >= 8; size -= 8, dst += 8)
+			*(word_t *) dst = pattern;
+		while (size-- > 0)
+			*dst++ = value;
+	} else if (has_erms ())
+		asm volatile ("rep stosb"
+				: "+D" (dst), "+c" (size) : "a" (value) : "memory");
+	else {
+		size_t words = size / 8;
+		size_t tail = size % 8;
+		asm volatile ("rep stosq"
+				: "+D" (dst), "+c" (words) : "a" (WORD_REPEAT (value)) : "memory");
+		asm volatile ("rep stosb"
+				: "+D" (dst), "+c" (tail) : "a" (value) : "memory");
+	}
 
 	return dst_;
 }
 
+/* Copies the PAGE_SIZE bytes of the page at SRC to the page at
+   DST.  Both must be page-aligned and must not overlap. */
+void
+copy_page (void *dst, const void *src) {
+	size_t words = PAGE_SIZE / 8;
+
+	ASSERT (dst != NULL && ((uintptr_t) dst & (PAGE_SIZE - 1)) == 0);
+	ASSERT (src != NULL && ((uintptr_t) src & (PAGE_SIZE - 1)) == 0);
+
+	asm volatile ("rep movsq"
+			: "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+}
+
+/* Zeroes the PAGE_SIZE bytes of the page-aligned page at DST. */
+void
+clear_page (void *dst) {
+	size_t words = PAGE_SIZE / 8;
+
+	ASSERT (dst != NULL && ((uintptr_t) dst & (PAGE_SIZE - 1)) == 0);
+
+	asm volatile ("rep stosq"
+			: "+D" (dst), "+c" (words) : "a" (0ul) : "memory");
+}
+
 /* Returns the length of STRING. */
 size_t
 strlen (const char *string) {
@@ -273,9 +484,15 @@ strlen (const char *string) {
 
 	ASSERT (string);
 
-	for (p = string; *p != '\0'; p++)
-		continue;
-	return p - string;
+	for (p = string; !WORD_ALIGNED (p); p++)
+		if (*p == '\0')
+			return p - string;
+
+	for (;; p += 8) {
+		uint64_t m = HAS_ZERO (*(const word_t *) p);
+		if (m)
+			return p - string + ZERO_INDEX (m);
+	}
 }
 
 /* If STRING is less than MAXLEN characters in length, returns
@@ -284,9 +501,21 @@ size_t
 strnlen (const char *string, size_t maxlen) {
 	size_t length;
 
-	for (length = 0; string[length] != '\0' && length < maxlen; length++)
-		continue;
-	return length;
+	for (length = 0; length < maxlen && !WORD_ALIGNED (string + length);
+			length++)
+		if (string[length] == '\0')
+			return length;
+
+	/* Aligned words may extend past MAXLEN but never past the page
+	   holding STRING[LENGTH], so reading them is safe. */
+	for (; length < maxlen; length += 8) {
+		uint64_t m = HAS_ZERO (*(const word_t *) (string + length));
+		if (m) {
+			length += ZERO_INDEX (m);
+			break;
+		}
+	}
+	return length < maxlen ? length : maxlen;
 }
 
 /* Copies string SRC to DST.  If SRC is longer than SIZE - 1
@@ -1,8 +1,51 @@
 #include <stdio.h>
 #include <string.h>
+#include <synch.h>
 #include <syscall.h>
 #include <syscall-nr.h>
 
+/* Output buffering.
+
+   Output to a handle collects in a stream buffer and goes to the
+   kernel in one write() when the buffer fills up, so that a line
+   built from several printf() and putchar() calls costs a single
+   system call.  The console is line-buffered, flushing at each
+   new-line, so that output still appears a line at a time and is
+   not lost if the process dies.  Other handles are fully
+   buffered.
+
+   Buffered output is flushed by fflush(), and on behalf of the
+   caller by the system call wrappers that could otherwise see
+   or leave behind stale data: exit(), fork(), and exec() flush
+   every stream, and calls that take a file descriptor flush that
+   descriptor's stream first.
+
+   The streams are shared by the threads of a process under
+   stdio_lock.  Writing out a stream calls write(), whose fflush()
+   must not wait for the lock its caller holds, so fflush() skips
+   the streams while another thread is in the middle of output;
+   that thread writes its output out itself. */
+
+/* Number of handles that may be buffered at once.  Writing to
+   another handle flushes and reuses one of the streams. */
+#define STREAM_CNT 4
+
+/* A buffered output handle. */
+struct stream {
+	int handle;                 /* Output handle, 0 if slot is free. */
+	size_t len;                 /* Bytes in buf. */
+	char buf[512];              /* Pending output. */
+};
+
+static struct stream streams[STREAM_CNT];
+static unsigned evict_next;     /* Next stream to reuse. */
+static struct mutex stdio_lock = MUTEX_INITIALIZER;
+
+static struct stream *get_stream (int handle);
+static void stream_putc (struct stream *, char);
+static void stream_write (struct stream *, const char *, size_t);
+static void stream_flush (struct stream *);
+
 /* The standard vprintf() function,
    which is like printf() but uses a va_list. */
 int
@@ -27,8 +70,13 @@ hprintf (int handle, const char *format, ...) {
    character. */
 int
 puts (const char *s) {
-	write (STDOUT_FILENO, s, strlen (s));
-	putchar ('\n');
+	struct stream *s_out;
+
+	mutex_lock (&stdio_lock);
+	s_out = get_stream (STDOUT_FILENO);
+	stream_write (s_out, s, strlen (s));
+	stream_putc (s_out, '\n');
+	mutex_unlock (&stdio_lock);
 
 	return 0;
 }
@@ -36,21 +84,50 @@ puts (const char *s) {
 /* Writes C to the console. */
 int
 putchar (int c) {
-	char c2 = c;
-	write (STDOUT_FILENO, &c2, 1);
+	mutex_lock (&stdio_lock);
+	stream_putc (get_stream (STDOUT_FILENO), c);
+	mutex_unlock (&stdio_lock);
 	return c;
 }
 
+/* Writes out the output buffered for HANDLE, or for every handle
+   if HANDLE is negative.  Returns 0. */
+int
+fflush (int handle) {
+	int i;
+
+	if (!mutex_trylock (&stdio_lock))
+		return 0;
+	for (i = 0; i < STREAM_CNT; i++)
+		if (streams[i].handle != 0
+				&& (handle < 0 || streams[i].handle == handle))
+			stream_flush (&streams[i]);
+	mutex_unlock (&stdio_lock);
+	return 0;
+}
+
+/* Flushes the output buffered for HANDLE, which is about to be
+   closed, and forgets HANDLE's stream. */
+void
+__fclose (int handle) {
+	int i;
+
+	mutex_lock (&stdio_lock);
+	for (i = 0; i < STREAM_CNT; i++)
+		if (streams[i].handle == handle) {
+			stream_flush (&streams[i]);
+			streams[i].handle = 0;
+		}
+	mutex_unlock (&stdio_lock);
+}
+
 /* Auxiliary data for vhprintf_helper(). */
 struct vhprintf_aux {
-	char buf[64];       /* Character buffer. */
-	char *p;            /* Current position in buffer. */
-	int char_cnt;       /* Total characters written so far. */
-	int handle;         /* Output file handle. */
+	struct stream *stream;      /* Output stream. */
+	int char_cnt;               /* Total characters written so far. */
 };
 
 static void add_char (char, void *);
-static void flush (struct vhprintf_aux *);
 
 /* Formats the printf() format specification FORMAT with
    arguments given in ARGS and writes the output to the given
@@ -58,29 +135,77 @@ static void flush (struct vhprintf_aux *);
 int
 vhprintf (int handle, const char *format, va_list args) {
 	struct vhprintf_aux aux;
-	aux.p = aux.buf;
+
+	mutex_lock (&stdio_lock);
+	aux.stream = get_stream (handle);
 	aux.char_cnt = 0;
-	aux.handle = handle;
 	__vprintf (format, args, add_char, &aux);
-	flush (&aux);
+	mutex_unlock (&stdio_lock);
 	return aux.char_cnt;
 }
 
-/* Adds C to the buffer in AUX, flushing it if the buffer fills
-   up. */
+/* Adds C to the stream in AUX. */
 static void
 add_char (char c, void *aux_) {
 	struct vhprintf_aux *aux = aux_;
-	*aux->p++ = c;
-	if (aux->p >= aux->buf + sizeof aux->buf)
-		flush (aux);
+	stream_putc (aux->stream, c);
 	aux->char_cnt++;
 }
 
-/* Flushes the buffer in AUX. */
+/* Returns the stream for HANDLE, taking over a free stream or,
+   failing that, flushing and reusing a busy one. */
+static struct stream *
+get_stream (int handle) {
+	struct stream *s;
+	int i;
+
+	for (i = 0; i < STREAM_CNT; i++)
+		if (streams[i].handle == handle)
+			return &streams[i];
+
+	for (i = 0; i < STREAM_CNT; i++)
+		if (streams[i].handle == 0)
+			break;
+	if (i == STREAM_CNT) {
+		i = evict_next++ % STREAM_CNT;
+		stream_flush (&streams[i]);
+	}
+
+	s = &streams[i];
+	s->handle = handle;
+	s->len = 0;
+	return s;
+}
+
+/* Appends C to S, flushing S if it fills up or, on the console,
+   if C ends a line. */
 static void
-flush (struct vhprintf_aux *aux) {
-	if (aux->p > aux->buf)
-		write (aux->handle, aux->buf, aux->p - aux->buf);
-	aux->p = aux->buf;
+stream_putc (struct stream *s, char c) {
+	s->buf[s->len++] = c;
+	if (s->len == sizeof s->buf
+			|| (c == '\n' && s->handle == STDOUT_FILENO))
+		stream_flush (s);
+}
+
+/* Appends the SIZE bytes in BUF to S.  Output too big for the
+   buffer bypasses it. */
+static void
+stream_write (struct stream *s, const char *buf, size_t size) {
+	if (size >= sizeof s->buf) {
+		stream_flush (s);
+		write (s->handle, buf, size);
+	} else
+		while (size-- > 0)
+			stream_putc (s, *buf++);
+}
+
+/* Writes out the output pending in S. */
+static void
+stream_flush (struct stream *s) {
+	size_t len = s->len;
+
+	/* Empty the buffer first, since write() flushes S itself. */
+	s->len = 0;
+	if (len > 0)
+		write (s->handle, s->buf, len);
 }
@@ -0,0 +1,318 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <synch.h>
+#include <syscall.h>
+
+/* User-space malloc().
+
+   Memory comes from the kernel through sbrk(), which grows the
+   heap just above the program's loaded image.
+
+   Small requests, up to MAX_SMALL bytes, are rounded up to a
+   power of 2 including a block header and served from a per-size
+   "bin".  A bin is a free list of blocks of its size: malloc()
+   pops the first block and free() pushes the block back, both in
+   constant time and without searching.  A bin that runs dry
+   carves a new block off the small pool, a run of memory taken
+   from sbrk() POOL_GROW bytes at a time.
+
+   Large requests are rounded up to whole pages.  Free large
+   blocks are kept on a single list in address order, so that
+   neighbours merge when freed; malloc() takes the first block
+   that fits and splits off what it does not need.  A free block
+   that ends at the program break is handed back to the kernel
+   instead.
+
+   The threads of a process share one heap under heap_lock.  The
+   lock is a futex mutex, so taking it costs one atomic
+   instruction unless two threads allocate at once.  There is
+   deliberately no per-thread cache of bins yet: user threads have
+   no thread-local storage (the kernel keeps no per-thread FS
+   base), so a thread has no cheap way to find its own cache.
+   Threads that allocate heavily at the same time contend on
+   heap_lock. */
+
+/* Magic number for detecting bad pointers passed to free(). */
+#define HEADER_MAGIC 0x5eb1ac0c
+
+/* Block header, 16 bytes to keep blocks 16-byte aligned. */
+struct header {
+	size_t size;            /* Block size, header included. */
+	unsigned magic;         /* Always HEADER_MAGIC. */
+	int bin;                /* Bin index, or -1 for a large block. */
+};
+
+/* Free small block. */
+struct small {
+	struct header header;
+	struct small *next;     /* Next block in bin. */
+};
+
+/* Free large block. */
+struct large {
+	struct header header;
+	struct large *next;     /* Next block, in address order. */
+};
+
+/* Small blocks are 2**MIN_SHIFT to 2**MAX_SHIFT bytes. */
+#define MIN_SHIFT 5
+#define MAX_SHIFT 11
+#define BIN_CNT (MAX_SHIFT - MIN_SHIFT + 1)
+#define MAX_SMALL ((1 << MAX_SHIFT) - sizeof (struct header))
+
+/* Large blocks are multiples of LARGE_UNIT bytes. */
+#define LARGE_UNIT 4096
+
+/* Bytes of small pool obtained from sbrk() at a time. */
+#define POOL_GROW (64 * 1024)
+
+static struct small *bins[BIN_CNT];     /* Free small blocks by size. */
+static uint8_t *pool, *pool_end;        /* Unused part of small pool. */
+static struct large *large_list;        /* Free large blocks. */
+static struct mutex heap_lock = MUTEX_INITIALIZER;
+
+static void *more_core (size_t);
+static struct header *alloc_small (int bin);
+static struct header *alloc_large (size_t size);
+static void free_large (struct large *);
+
+/* Returns the bin that serves blocks of SIZE bytes, header
+   included. */
+static inline int
+size_to_bin (size_t size) {
+	int bin = 0;
+
+	while (((size_t) 1 << (bin + MIN_SHIFT)) < size)
+		bin++;
+	return bin;
+}
+
+/* Returns the size of the blocks in BIN. */
+static inline size_t
+bin_size (int bin) {
+	return (size_t) 1 << (bin + MIN_SHIFT);
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size) {
+	struct header *h;
+
+	/* A null pointer satisfies a request for 0 bytes. */
+	if (size == 0)
+		return NULL;
+
+	mutex_lock (&heap_lock);
+	if (size <= MAX_SMALL)
+		h = alloc_small (size_to_bin (size + sizeof *h));
+	else if (size > SIZE_MAX - LARGE_UNIT - sizeof *h)
+		h = NULL;
+	else
+		h = alloc_large (ROUND_UP (size + sizeof *h, LARGE_UNIT));
+	mutex_unlock (&heap_lock);
+
+	return h != NULL ? h + 1 : NULL;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b) {
+	void *p;
+	size_t size;
+
+	/* Calculate block size and make sure it fits in size_t. */
+	size = a * b;
+	if (a != 0 && size / a != b)
+		return NULL;
+
+	/* Allocate and zero memory. */
+	p = malloc (size);
+	if (p != NULL)
+		memset (p, 0, size);
+
+	return p;
+}
+
+/* Returns the header of block P, checking that P came from
+   malloc(). */
+static struct header *
+block_header (void *p) {
+	struct header *h = (struct header *) p - 1;
+
+	ASSERT (h->magic == HEADER_MAGIC);
+	return h;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size) {
+	struct header *h;
+	void *new_block;
+	size_t old_size;
+
+	if (new_size == 0) {
+		free (old_block);
+		return NULL;
+	}
+	if (old_block == NULL)
+		return malloc (new_size);
+
+	/* Keep the block if it is the one malloc(NEW_SIZE) would have
+	   picked, or a large block that still fits. */
+	h = block_header (old_block);
+	old_size = h->size - sizeof *h;
+	if (h->bin >= 0 ? new_size <= MAX_SMALL
+			&& size_to_bin (new_size + sizeof *h) == h->bin
+			: new_size > MAX_SMALL && new_size <= old_size)
+		return old_block;
+
+	new_block = malloc (new_size);
+	if (new_block != NULL) {
+		memcpy (new_block, old_block, new_size < old_size ? new_size : old_size);
+		free (old_block);
+	}
+	return new_block;
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p) {
+	struct header *h;
+
+	if (p == NULL)
+		return;
+
+	h = block_header (p);
+	mutex_lock (&heap_lock);
+	if (h->bin >= 0) {
+		struct small *s = (struct small *) h;
+		s->next = bins[h->bin];
+		bins[h->bin] = s;
+	} else
+		free_large ((struct large *) h);
+	mutex_unlock (&heap_lock);
+}
+
+/* Grows the heap by SIZE bytes and returns the start of the new
+   memory, or a null pointer if the kernel refuses. */
+static void *
+more_core (size_t size) {
+	void *p = sbrk (size);
+	return p != (void *) -1 ? p : NULL;
+}
+
+/* Initializes H as the header of a block of SIZE bytes in BIN. */
+static inline struct header *
+init_header (struct header *h, size_t size, int bin) {
+	h->size = size;
+	h->magic = HEADER_MAGIC;
+	h->bin = bin;
+	return h;
+}
+
+/* Returns a block from BIN, or a null pointer if memory is not
+   available. */
+static struct header *
+alloc_small (int bin) {
+	size_t size = bin_size (bin);
+	uint8_t *block;
+
+	/* Reuse a freed block if there is one. */
+	if (bins[bin] != NULL) {
+		struct small *s = bins[bin];
+		bins[bin] = s->next;
+		return &s->header;
+	}
+
+	/* Otherwise carve one off the pool, refilling it first if
+	   needed.  Whatever is left of an old pool that is not
+	   contiguous with the new one is abandoned. */
+	if ((size_t) (pool_end - pool) < size) {
+		uint8_t *more = more_core (POOL_GROW);
+		if (more == NULL)
+			return NULL;
+		if (more != pool_end)
+			pool = more;
+		pool_end = more + POOL_GROW;
+	}
+	block = pool;
+	pool += size;
+	return init_header ((struct header *) block, size, bin);
+}
+
+/* Returns a large block of SIZE bytes, a multiple of LARGE_UNIT,
+   or a null pointer if memory is not available. */
+static struct header *
+alloc_large (size_t size) {
+	struct large **lp;
+	void *block;
+
+	/* First fit, splitting off the tail that is not needed. */
+	for (lp = &large_list; *lp != NULL; lp = &(*lp)->next) {
+		struct large *l = *lp;
+
+		if (l->header.size < size)
+			continue;
+		if (l->header.size > size) {
+			struct large *rest = (struct large *) ((uint8_t *) l + size);
+			init_header (&rest->header, l->header.size - size, -1);
+			rest->next = l->next;
+			*lp = rest;
+		} else
+			*lp = l->next;
+		return init_header (&l->header, size, -1);
+	}
+
+	block = more_core (size);
+	return block != NULL ? init_header (block, size, -1) : NULL;
+}
+
+/* Returns large block L to the free list, merging it with free
+   neighbours, and gives it back to the kernel if it ends up at
+   the top of the heap. */
+static void
+free_large (struct large *l) {
+	struct large **lp, *prev = NULL;
+
+	/* Find L's place in address order. */
+	for (lp = &large_list; *lp != NULL && *lp < l; lp = &(*lp)->next)
+		prev = *lp;
+	l->next = *lp;
+	*lp = l;
+
+	/* Merge with the following block, then with the preceding
+	   one. */
+	if (l->next != NULL
+			&& (uint8_t *) l + l->header.size == (uint8_t *) l->next) {
+		l->header.size += l->next->header.size;
+		l->next = l->next->next;
+	}
+	if (prev != NULL
+			&& (uint8_t *) prev + prev->header.size == (uint8_t *) l) {
+		prev->header.size += l->header.size;
+		prev->next = l->next;
+		l = prev;
+	}
+
+	/* The last free block may sit right below the break. */
+	if (l->next == NULL && (uint8_t *) l + l->header.size == sbrk (0)) {
+		struct large **tail;
+
+		for (tail = &large_list; *tail != l; tail = &(*tail)->next)
+			continue;
+		*tail = NULL;
+		sbrk (-(intptr_t) l->header.size);
+	}
+}
@@ -0,0 +1,107 @@
+#include <synch.h>
+#include <debug.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* User-space mutexes and condition variables on top of futexes.
+
+   A mutex is an int that is 0 when free, 1 when held, and 2 when
+   held and someone may be sleeping on it.  Taking a free mutex
+   and releasing one that nobody waits for are each a single
+   atomic instruction; the kernel is entered only to sleep in
+   futex_wait() and, from 2, to wake a sleeper in futex_wake().
+   See Ulrich Drepper, "Futexes Are Tricky".
+
+   A condition variable is a sequence number that every signal
+   bumps.  A waiter samples it before releasing the mutex and
+   sleeps only if it has not changed since, so a signal sent in
+   between is never missed.  Signals with nobody waiting stay out
+   of the kernel. */
+
+/* Initializes M as a free mutex. */
+void
+mutex_init (struct mutex *m) {
+	ASSERT (m != NULL);
+	m->state = 0;
+}
+
+/* Acquires M, sleeping until it is free if necessary. */
+void
+mutex_lock (struct mutex *m) {
+	int c = 0;
+
+	if (__atomic_compare_exchange_n (&m->state, &c, 1, false,
+				__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return;
+
+	/* Contended.  Mark M so that its holder wakes us up. */
+	if (c != 2)
+		c = __atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE);
+	while (c != 0) {
+		futex_wait (&m->state, 2);
+		c = __atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE);
+	}
+}
+
+/* Tries to acquire M without sleeping.  Returns true if
+   successful, false if M is held. */
+bool
+mutex_trylock (struct mutex *m) {
+	int c = 0;
+
+	return __atomic_compare_exchange_n (&m->state, &c, 1, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/* Releases M, which the caller must hold, waking a thread that
+   waits for it, if any. */
+void
+mutex_unlock (struct mutex *m) {
+	if (__atomic_fetch_sub (&m->state, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n (&m->state, 0, __ATOMIC_RELEASE);
+		futex_wake (&m->state, 1);
+	}
+}
+
+/* Initializes CV. */
+void
+condvar_init (struct condvar *cv) {
+	ASSERT (cv != NULL);
+	cv->seq = 0;
+	cv->waiter_cnt = 0;
+}
+
+/* Atomically releases M and waits for CV to be signalled, then
+   reacquires M before returning.  M must be held.  As with any
+   condition variable, the caller must recheck its condition
+   after waking up. */
+void
+condvar_wait (struct condvar *cv, struct mutex *m) {
+	int seq = __atomic_load_n (&cv->seq, __ATOMIC_ACQUIRE);
+
+	__atomic_fetch_add (&cv->waiter_cnt, 1, __ATOMIC_ACQ_REL);
+	mutex_unlock (m);
+	futex_wait (&cv->seq, seq);
+	__atomic_fetch_sub (&cv->waiter_cnt, 1, __ATOMIC_ACQ_REL);
+
+	/* Other waiters may have woken with us, so take M as if it
+	   were contended, to be sure they get woken in turn. */
+	while (__atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE) != 0)
+		futex_wait (&m->state, 2);
+}
+
+/* Wakes one thread waiting on CV, if any. */
+void
+condvar_signal (struct condvar *cv) {
+	__atomic_fetch_add (&cv->seq, 1, __ATOMIC_ACQ_REL);
+	if (__atomic_load_n (&cv->waiter_cnt, __ATOMIC_ACQUIRE) > 0)
+		futex_wake (&cv->seq, 1);
+}
+
+/* Wakes every thread waiting on CV. */
+void
+condvar_broadcast (struct condvar *cv) {
+	__atomic_fetch_add (&cv->seq, 1, __ATOMIC_ACQ_REL);
+	if (__atomic_load_n (&cv->waiter_cnt, __ATOMIC_ACQUIRE) > 0)
+		futex_wake (&cv->seq, INT_MAX);
+}
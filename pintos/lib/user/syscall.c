@@ -1,5 +1,6 @@
 #include <syscall.h>
 #include <stdint.h>
+#include <stdio.h>
 #include "../syscall-nr.h"
 
 __attribute__((always_inline))
@@ -70,23 +71,27 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			0))
 void
 halt (void) {
+	fflush (-1);
 	syscall0 (SYS_HALT);
 	NOT_REACHED ();
 }
 
 void
 exit (int status) {
+	fflush (-1);
 	syscall1 (SYS_EXIT, status);
 	NOT_REACHED ();
 }
 
 pid_t
 fork (const char *thread_name){
+	fflush (-1);
 	return (pid_t) syscall1 (SYS_FORK, thread_name);
 }
 
 int
 exec (const char *file) {
+	fflush (-1);
 	return (pid_t) syscall1 (SYS_EXEC, file);
 }
 
@@ -112,41 +117,50 @@ open (const char *file) {
 
 int
 filesize (int fd) {
+	fflush (fd);
 	return syscall1 (SYS_FILESIZE, fd);
 }
 
 int
 read (int fd, void *buffer, unsigned size) {
+	fflush (fd == STDIN_FILENO ? STDOUT_FILENO : fd);
 	return syscall3 (SYS_READ, fd, buffer, size);
 }
 
 int
 write (int fd, const void *buffer, unsigned size) {
+	fflush (fd);
 	return syscall3 (SYS_WRITE, fd, buffer, size);
 }
 
 void
 seek (int fd, unsigned position) {
+	fflush (fd);
 	syscall2 (SYS_SEEK, fd, position);
 }
 
 unsigned
 tell (int fd) {
+	fflush (fd);
 	return syscall1 (SYS_TELL, fd);
 }
 
 void
 close (int fd) {
+	__fclose (fd);
 	syscall1 (SYS_CLOSE, fd);
 }
 
 int
 dup2 (int oldfd, int newfd){
+	fflush (oldfd);
+	__fclose (newfd);
 	return syscall2 (SYS_DUP2, oldfd, newfd);
 }
 
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
+	fflush (fd);
 	return (void *) syscall5 (SYS_MMAP, addr, length, writable, fd, offset);
 }
 
@@ -194,3 +208,116 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+int
+dmesg (void *buffer, unsigned size) {
+	return syscall2 (SYS_DMESG, buffer, size);
+}
+
+int
+pmc_read (uint64_t counts[], unsigned cnt) {
+	return syscall2 (SYS_PMC_READ, counts, cnt);
+}
+
+void *
+sbrk (intptr_t increment) {
+	return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+int
+futex_wait (int *addr, int expected) {
+	return syscall2 (SYS_FUTEX_WAIT, addr, expected);
+}
+
+int
+futex_wake (int *addr, int cnt) {
+	return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
+
+/* What a new thread runs, stored at the top of its stack. */
+struct spawn_args {
+	thread_func *func;
+	void *aux;
+};
+
+/* First function run in a thread started by thread_spawn(). */
+static void NO_RETURN
+spawn_trampoline (struct spawn_args *args) {
+	thread_exit (args->func (args->aux));
+}
+
+/* Starts a thread in this process that runs FUNC (AUX) on the
+   stack whose top is STACK, which must stay allocated until the
+   thread is joined. */
+tid_t
+thread_spawn (thread_func *func, void *stack, void *aux) {
+	struct spawn_args *args = (struct spawn_args *)
+		(((uintptr_t) stack - sizeof *args) & ~(uintptr_t) 0xf);
+
+	args->func = func;
+	args->aux = aux;
+	return syscall3 (SYS_THREAD_SPAWN, spawn_trampoline, args, args);
+}
+
+int
+thread_join (tid_t tid) {
+	return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+void
+thread_exit (int status) {
+	syscall1 (SYS_THREAD_EXIT, status);
+	NOT_REACHED ();
+}
+
+
+int
+pipe (int fds[2]) {
+	return pipe2 (fds, 0);
+}
+
+int
+pipe2 (int fds[2], int flags) {
+	return syscall2 (SYS_PIPE, fds, flags);
+}
+
+/* Like write() on a pipe's write end or read() on its read end,
+   but moves the page-aligned whole pages of BUFFER instead of
+   copying them where it can.  Pages moved into the pipe read as
+   zeros afterward. */
+int
+vmsplice (int fd, void *buffer, unsigned size) {
+	fflush (fd);
+	return syscall3 (SYS_VMSPLICE, fd, buffer, size);
+}
+
+/* Maps SIZE bytes of the shared memory segment NAME at the
+   page-aligned ADDR, creating a zeroed segment of SIZE bytes if
+   there is none by that name.  SIZE may be 0 to map all of an
+   existing segment.  Returns ADDR, or MAP_FAILED.  munmap (ADDR)
+   unmaps it again. */
+void *
+shm_map (const char *name, void *addr, size_t size) {
+	return (void *) syscall3 (SYS_SHM_MAP, name, addr, size);
+}
+
+bool
+shm_unlink (const char *name) {
+	return syscall1 (SYS_SHM_UNLINK, name);
+}
+
+/* Sets up asynchronous I/O rings of ENTRIES entries each, a power
+   of 2 up to IO_ENTRIES_MAX, in a page mapped at the page-aligned
+   ADDR.  Returns the rings, or a null pointer on failure. */
+struct io_rings *
+io_setup (void *addr, unsigned entries) {
+	return syscall2 (SYS_IO_SETUP, addr, entries) == 0 ? addr : NULL;
+}
+
+/* Starts up to TO_SUBMIT queued requests, then waits until at
+   least MIN_COMPLETE completions are ready or none are running.
+   Returns the number of requests started, or -1. */
+int
+io_enter (unsigned to_submit, unsigned min_complete) {
+	return syscall2 (SYS_IO_ENTER, to_submit, min_complete);
+}
@@ -0,0 +1,43 @@
+/* Measures a context switch: two threads of equal priority take
+   turns waking each other through a pair of semaphores, so each
+   round trip is two switches. */
+
+#include <stdio.h>
+#include "tests/bench/bench.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define ROUNDS 20000
+
+static struct semaphore ping, pong;
+
+static void
+ponger (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ROUNDS; i++)
+    {
+      sema_down (&ping);
+      sema_up (&pong);
+    }
+}
+
+void
+bench_ctxsw (void)
+{
+  uint64_t start;
+  int i;
+
+  sema_init (&ping, 0);
+  sema_init (&pong, 0);
+  thread_create ("ponger", thread_get_priority (), ponger, NULL);
+
+  start = bench_clock ();
+  for (i = 0; i < ROUNDS; i++)
+    {
+      sema_up (&ping);
+      sema_down (&pong);
+    }
+  bench_report ("pingpong", ROUNDS, start);
+}
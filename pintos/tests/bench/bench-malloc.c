@@ -0,0 +1,51 @@
+/* Measures malloc() and free(): a fixed-size allocation freed at
+   once, then churn through a table of blocks of random sizes,
+   freeing or allocating a random slot each time. */
+
+#include <random.h>
+#include <stdio.h>
+#include "tests/bench/bench.h"
+#include "threads/malloc.h"
+
+#define SMALL_OPS 100000
+#define CHURN_OPS 200000
+#define CHURN_SLOTS 512
+#define CHURN_MAX_SIZE 2048
+
+void
+bench_malloc (void)
+{
+  static void *slots[CHURN_SLOTS];
+  uint64_t start;
+  int i;
+
+  start = bench_clock ();
+  for (i = 0; i < SMALL_OPS; i++)
+    {
+      void *p = malloc (32);
+      if (p == NULL)
+        bench_fail ("malloc failed");
+      free (p);
+    }
+  bench_report ("small", SMALL_OPS, start);
+
+  random_init (0);
+  start = bench_clock ();
+  for (i = 0; i < CHURN_OPS; i++)
+    {
+      void **slot = &slots[random_ulong () % CHURN_SLOTS];
+      if (*slot != NULL)
+        {
+          free (*slot);
+          *slot = NULL;
+        }
+      else if ((*slot = malloc (1 + random_ulong () % CHURN_MAX_SIZE)) == NULL)
+        bench_fail ("malloc failed");
+    }
+  for (i = 0; i < CHURN_SLOTS; i++)
+    {
+      free (slots[i]);
+      slots[i] = NULL;
+    }
+  bench_report ("churn", CHURN_OPS, start);
+}
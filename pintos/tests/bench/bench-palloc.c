@@ -0,0 +1,37 @@
+/* Measures the page allocator, for single pages and for runs of
+   contiguous pages. */
+
+#include <stdio.h>
+#include "tests/bench/bench.h"
+#include "threads/palloc.h"
+
+#define PAGE_OPS 20000
+#define MULTIPLE_OPS 5000
+#define MULTIPLE_PAGES 8
+
+void
+bench_palloc (void)
+{
+  uint64_t start;
+  int i;
+
+  start = bench_clock ();
+  for (i = 0; i < PAGE_OPS; i++)
+    {
+      void *p = palloc_get_page (0);
+      if (p == NULL)
+        bench_fail ("palloc_get_page failed");
+      palloc_free_page (p);
+    }
+  bench_report ("page", PAGE_OPS, start);
+
+  start = bench_clock ();
+  for (i = 0; i < MULTIPLE_OPS; i++)
+    {
+      void *p = palloc_get_multiple (0, MULTIPLE_PAGES);
+      if (p == NULL)
+        bench_fail ("palloc_get_multiple failed");
+      palloc_free_multiple (p, MULTIPLE_PAGES);
+    }
+  bench_report ("multiple-8", MULTIPLE_OPS, start);
+}
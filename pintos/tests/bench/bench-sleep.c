@@ -0,0 +1,47 @@
+/* Measures a timer_sleep() storm: many threads repeatedly sleep
+   for a single tick, so the timer interrupt wakes a crowd of
+   them at once. */
+
+#include <stdio.h>
+#include "tests/bench/bench.h"
+#include "devices/timer.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define SLEEPERS 32
+#define SLEEPS 10
+
+static struct semaphore done;
+
+static void
+sleeper (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < SLEEPS; i++)
+    timer_sleep (1);
+  sema_up (&done);
+}
+
+void
+bench_sleep (void)
+{
+  int64_t start_ticks;
+  uint64_t start;
+  int i;
+
+  sema_init (&done, 0);
+  start_ticks = timer_ticks ();
+  start = bench_clock ();
+  for (i = 0; i < SLEEPERS; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "sleeper %d", i);
+      thread_create (name, thread_get_priority (), sleeper, NULL);
+    }
+  for (i = 0; i < SLEEPERS; i++)
+    sema_down (&done);
+  bench_report ("timer-sleep", SLEEPERS * SLEEPS, start);
+  bench_msg ("%d sleeps of 1 tick took %lld ticks",
+             SLEEPS, timer_elapsed (start_ticks));
+}
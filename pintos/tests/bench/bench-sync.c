@@ -0,0 +1,68 @@
+/* Measures semaphores and locks, uncontended and with several
+   threads contending for one lock.  Contending threads yield
+   while holding the lock, so every acquire but the first in a
+   round has to block. */
+
+#include <stdio.h>
+#include "tests/bench/bench.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define UNCONTENDED_OPS 100000
+#define CONTENDERS 4
+#define CONTENDED_ITERS 2000
+
+static struct lock lock;
+static struct semaphore done;
+
+static void
+contender (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < CONTENDED_ITERS; i++)
+    {
+      lock_acquire (&lock);
+      thread_yield ();
+      lock_release (&lock);
+    }
+  sema_up (&done);
+}
+
+void
+bench_sync (void)
+{
+  struct semaphore sema;
+  uint64_t start;
+  int i;
+
+  sema_init (&sema, 0);
+  start = bench_clock ();
+  for (i = 0; i < UNCONTENDED_OPS; i++)
+    {
+      sema_up (&sema);
+      sema_down (&sema);
+    }
+  bench_report ("sema-uncontended", UNCONTENDED_OPS, start);
+
+  lock_init (&lock);
+  start = bench_clock ();
+  for (i = 0; i < UNCONTENDED_OPS; i++)
+    {
+      lock_acquire (&lock);
+      lock_release (&lock);
+    }
+  bench_report ("lock-uncontended", UNCONTENDED_OPS, start);
+
+  sema_init (&done, 0);
+  start = bench_clock ();
+  for (i = 0; i < CONTENDERS; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "contender %d", i);
+      thread_create (name, thread_get_priority (), contender, NULL);
+    }
+  for (i = 0; i < CONTENDERS; i++)
+    sema_down (&done);
+  bench_report ("lock-contended", CONTENDERS * CONTENDED_ITERS, start);
+}
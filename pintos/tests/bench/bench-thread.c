@@ -0,0 +1,50 @@
+/* Measures thread creation and exit: one thread at a time, each
+   created, run to completion, and waited for, and then batches of
+   workers that are all created before any of them is waited
+   for. */
+
+#include <stdio.h>
+#include "tests/bench/bench.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define SERIAL_OPS 5000
+#define BATCH_ROUNDS 100
+#define BATCH_SIZE 32
+
+static struct semaphore done;
+
+static void
+worker (void *aux UNUSED)
+{
+  sema_up (&done);
+}
+
+void
+bench_thread (void)
+{
+  uint64_t start;
+  int i, j;
+
+  sema_init (&done, 0);
+
+  start = bench_clock ();
+  for (i = 0; i < SERIAL_OPS; i++)
+    {
+      if (thread_create ("worker", PRI_DEFAULT, worker, NULL) == TID_ERROR)
+        bench_fail ("thread_create failed");
+      sema_down (&done);
+    }
+  bench_report ("create-exit", SERIAL_OPS, start);
+
+  start = bench_clock ();
+  for (i = 0; i < BATCH_ROUNDS; i++)
+    {
+      for (j = 0; j < BATCH_SIZE; j++)
+        if (thread_create ("worker", PRI_DEFAULT, worker, NULL) == TID_ERROR)
+          bench_fail ("thread_create failed");
+      for (j = 0; j < BATCH_SIZE; j++)
+        sema_down (&done);
+    }
+  bench_report ("batch-32", BATCH_ROUNDS * BATCH_SIZE, start);
+}
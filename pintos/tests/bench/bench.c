@@ -0,0 +1,143 @@
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+
+/* In-kernel microbenchmarks.
+
+   Each benchmark runs a fixed, repeatable workload and reports
+   one line per measured case:
+
+     BENCH bench-NAME CASE ops=N ns=T ns/op=X ops/s=Y
+
+   tests/bench/bench-compare reads these lines and compares them
+   against a stored baseline. */
+
+struct bench
+  {
+    const char *name;
+    bench_func *function;
+  };
+
+static const struct bench benches[] =
+  {
+    {"bench-ctxsw", bench_ctxsw},
+    {"bench-sync", bench_sync},
+    {"bench-sleep", bench_sleep},
+    {"bench-malloc", bench_malloc},
+    {"bench-palloc", bench_palloc},
+    {"bench-thread", bench_thread},
+  };
+
+static const char *bench_name;
+
+/* Timer ticks to calibrate the time stamp counter over. */
+#define CALIBRATE_TICKS (TIMER_FREQ / 5)
+
+/* Time stamp counter ticks per microsecond. */
+static uint64_t tsc_per_us;
+
+/* Reads the time stamp counter. */
+static uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Measures the time stamp counter's rate against the timer. */
+static void
+calibrate (void)
+{
+  int64_t start = timer_ticks ();
+  uint64_t tsc;
+
+  while (timer_ticks () == start)
+    continue;
+  start = timer_ticks ();
+  tsc = rdtsc ();
+  while (timer_elapsed (start) < CALIBRATE_TICKS)
+    continue;
+  tsc_per_us = (rdtsc () - tsc) * TIMER_FREQ / (CALIBRATE_TICKS * 1000000);
+  if (tsc_per_us == 0)
+    tsc_per_us = 1;
+}
+
+/* Runs the benchmark named NAME and returns true, or returns
+   false if there is no such benchmark. */
+bool
+run_bench (const char *name)
+{
+  const struct bench *b;
+
+  for (b = benches; b < benches + sizeof benches / sizeof *benches; b++)
+    if (!strcmp (name, b->name))
+      {
+        bench_name = name;
+        bench_msg ("begin");
+        if (tsc_per_us == 0)
+          calibrate ();
+        bench_msg ("TSC at %llu MHz", tsc_per_us);
+        b->function ();
+        bench_msg ("end");
+        return true;
+      }
+  return false;
+}
+
+/* Returns the current time, in time stamp counter ticks. */
+uint64_t
+bench_clock (void)
+{
+  return rdtsc ();
+}
+
+/* Reports that case NAME of the running benchmark performed OPS
+   operations since bench_clock() returned START. */
+void
+bench_report (const char *name, uint64_t ops, uint64_t start)
+{
+  uint64_t ns = (bench_clock () - start) * 1000 / tsc_per_us;
+
+  if (ns == 0)
+    ns = 1;
+  printf ("BENCH %s %s ops=%llu ns=%llu ns/op=%llu ops/s=%llu\n",
+          bench_name, name, ops, ns, ops ? ns / ops : 0,
+          ops * 1000000000 / ns);
+}
+
+/* Prints FORMAT as if with printf(),
+   prefixing the output by the name of the benchmark
+   and following it with a new-line character. */
+void
+bench_msg (const char *format, ...)
+{
+  va_list args;
+
+  printf ("(%s) ", bench_name);
+  va_start (args, format);
+  vprintf (format, args);
+  va_end (args);
+  putchar ('\n');
+}
+
+/* Prints failure message FORMAT as if with printf(),
+   prefixing the output by the name of the benchmark and FAIL:
+   and following it with a new-line character,
+   and then panics the kernel. */
+void
+bench_fail (const char *format, ...)
+{
+  va_list args;
+
+  printf ("(%s) FAIL: ", bench_name);
+  va_start (args, format);
+  vprintf (format, args);
+  va_end (args);
+  putchar ('\n');
+
+  PANIC ("benchmark failed");
+}
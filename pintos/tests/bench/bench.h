@@ -0,0 +1,23 @@
+#ifndef TESTS_BENCH_BENCH_H
+#define TESTS_BENCH_BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+bool run_bench (const char *);
+
+typedef void bench_func (void);
+
+extern bench_func bench_ctxsw;
+extern bench_func bench_sync;
+extern bench_func bench_sleep;
+extern bench_func bench_malloc;
+extern bench_func bench_palloc;
+extern bench_func bench_thread;
+
+uint64_t bench_clock (void);
+void bench_report (const char *name, uint64_t ops, uint64_t start);
+void bench_msg (const char *, ...);
+void bench_fail (const char *, ...);
+
+#endif /* tests/bench/bench.h */
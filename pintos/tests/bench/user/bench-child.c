@@ -0,0 +1,7 @@
+/* Child process for bench-fork: exits at once. */
+
+int
+main (void)
+{
+  return 0;
+}
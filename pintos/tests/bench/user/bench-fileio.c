@@ -0,0 +1,51 @@
+/* Measures file I/O: writes a file sequentially, reads it back
+   sequentially, then reads small blocks at random offsets. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/bench/user/ubench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (64 * 1024)
+#define SEQ_BLOCK 4096
+#define RAND_BLOCK 512
+#define RAND_OPS 512
+
+static char buf[SEQ_BLOCK];
+
+void
+test_main (void)
+{
+  const char *file_name = "bench.dat";
+  uint64_t start;
+  int fd, i;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  start = bench_clock ();
+  for (i = 0; i < FILE_SIZE / SEQ_BLOCK; i++)
+    if (write (fd, buf, SEQ_BLOCK) != SEQ_BLOCK)
+      fail ("write failed");
+  bench_report ("seq-write", FILE_SIZE / SEQ_BLOCK, start);
+
+  seek (fd, 0);
+  start = bench_clock ();
+  for (i = 0; i < FILE_SIZE / SEQ_BLOCK; i++)
+    if (read (fd, buf, SEQ_BLOCK) != SEQ_BLOCK)
+      fail ("read failed");
+  bench_report ("seq-read", FILE_SIZE / SEQ_BLOCK, start);
+
+  start = bench_clock ();
+  for (i = 0; i < RAND_OPS; i++)
+    {
+      seek (fd, random_ulong () % (FILE_SIZE / RAND_BLOCK) * RAND_BLOCK);
+      if (read (fd, buf, RAND_BLOCK) != RAND_BLOCK)
+        fail ("read failed");
+    }
+  bench_report ("rand-read", RAND_OPS, start);
+
+  close (fd);
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+}
@@ -0,0 +1,40 @@
+/* Measures process creation: fork() then wait() for a child that
+   exits at once, and fork() then exec() of a trivial program. */
+
+#include <syscall.h>
+#include "tests/bench/user/ubench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUNDS 20
+
+void
+test_main (void)
+{
+  uint64_t start;
+  pid_t pid;
+  int i;
+
+  start = bench_clock ();
+  for (i = 0; i < ROUNDS; i++)
+    {
+      if ((pid = fork ("child")) == 0)
+        exit (0);
+      if (pid < 0 || wait (pid) != 0)
+        fail ("fork/wait failed");
+    }
+  bench_report ("fork-wait", ROUNDS, start);
+
+  start = bench_clock ();
+  for (i = 0; i < ROUNDS; i++)
+    {
+      if ((pid = fork ("child")) == 0)
+        {
+          exec ("bench-child");
+          exit (-1);
+        }
+      if (pid < 0 || wait (pid) != 0)
+        fail ("fork/exec/wait failed");
+    }
+  bench_report ("fork-exec-wait", ROUNDS, start);
+}
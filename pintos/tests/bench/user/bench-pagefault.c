@@ -0,0 +1,23 @@
+/* Measures page faults: touches each page of a large zeroed
+   array once, so that with lazy loading every touch faults. */
+
+#include <stdint.h>
+#include "tests/bench/user/ubench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGES 256
+
+static volatile uint8_t pages[PAGES][4096];
+
+void
+test_main (void)
+{
+  uint64_t start;
+  int i;
+
+  start = bench_clock ();
+  for (i = 0; i < PAGES; i++)
+    pages[i][0] = 1;
+  bench_report ("bss-touch", PAGES, start);
+}
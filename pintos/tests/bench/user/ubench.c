@@ -0,0 +1,18 @@
+#include "tests/bench/user/ubench.h"
+#include <stdio.h>
+#include "tests/lib.h"
+
+/* Reports that case NAME of the running benchmark performed OPS
+   operations since bench_clock() returned START.  User programs
+   cannot calibrate the time stamp counter against the timer, so
+   they report cycles instead of nanoseconds:
+
+     BENCH bench-NAME CASE ops=N cycles=C cycles/op=X */
+void
+bench_report (const char *name, uint64_t ops, uint64_t start)
+{
+  uint64_t cycles = bench_clock () - start;
+
+  printf ("BENCH %s %s ops=%llu cycles=%llu cycles/op=%llu\n",
+          test_name, name, ops, cycles, ops ? cycles / ops : 0);
+}
@@ -0,0 +1,17 @@
+#ifndef TESTS_BENCH_USER_UBENCH_H
+#define TESTS_BENCH_USER_UBENCH_H
+
+#include <stdint.h>
+
+/* Reads the time stamp counter. */
+static inline uint64_t
+bench_clock (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+void bench_report (const char *name, uint64_t ops, uint64_t start);
+
+#endif /* tests/bench/user/ubench.h */
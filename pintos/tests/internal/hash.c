@@ -0,0 +1,182 @@
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <ohash.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a hash table that we will
+   test. */
+#define MAX_SIZE 1024
+
+/* A hash table element. */
+struct value
+{
+  struct hash_elem elem; /* Hash element. */
+  int value;             /* Item value. */
+};
+
+static struct value values[MAX_SIZE];
+static bool present[MAX_SIZE];
+
+static uint64_t value_hash(const struct hash_elem *, void *);
+static bool value_less(const struct hash_elem *, const struct hash_elem *,
+                       void *);
+static void test_chained(int size);
+static void test_open(int size);
+
+/* Test the chained and open-addressing hash table
+   implementations. */
+void test(void)
+{
+  int size;
+
+  for (size = 0; size < MAX_SIZE; size++)
+    values[size].value = size;
+
+  printf("testing various size hash tables:");
+  for (size = 1; size <= MAX_SIZE; size *= 2)
+  {
+    printf(" %d", size);
+    test_chained(size);
+    test_open(size);
+  }
+
+  printf(" done\n");
+  printf("hash: PASS\n");
+}
+
+/* Applies random insertions, replacements and deletions of
+   values 0...SIZE to a chained hash table, checking each result
+   against PRESENT.  Growing and shrinking happens incrementally
+   along the way. */
+static void
+test_chained(int size)
+{
+  struct hash hash;
+  struct hash_iterator i;
+  size_t cnt = 0;
+  int op;
+
+  ASSERT(hash_init(&hash, value_hash, value_less, NULL));
+  memset(present, 0, sizeof present);
+  for (op = 0; op < size * 16; op++)
+  {
+    struct value *v = &values[random_ulong() % size];
+
+    switch (random_ulong() % 4)
+    {
+    case 0:
+      ASSERT((hash_insert(&hash, &v->elem) != NULL) == present[v->value]);
+      break;
+    case 1:
+      ASSERT((hash_replace(&hash, &v->elem) != NULL) == present[v->value]);
+      break;
+    case 2:
+      ASSERT((hash_find(&hash, &v->elem) != NULL) == present[v->value]);
+      continue;
+    default:
+      ASSERT((hash_delete(&hash, &v->elem) != NULL) == present[v->value]);
+      if (present[v->value])
+        cnt--;
+      present[v->value] = false;
+      ASSERT(hash_size(&hash) == cnt);
+      continue;
+    }
+    if (!present[v->value])
+      cnt++;
+    present[v->value] = true;
+    ASSERT(hash_size(&hash) == cnt);
+  }
+
+  /* Every element is visited exactly once. */
+  hash_first(&i, &hash);
+  while (hash_next(&i))
+  {
+    struct value *v = hash_entry(hash_cur(&i), struct value, elem);
+    ASSERT(present[v->value]);
+    present[v->value] = false;
+    cnt--;
+  }
+  ASSERT(cnt == 0);
+
+  hash_destroy(&hash, NULL);
+}
+
+/* Same as test_chained(), for an open-addressing hash table. */
+static void
+test_open(int size)
+{
+  struct ohash hash;
+  struct ohash_iterator i;
+  size_t cnt = 0;
+  int op;
+
+  ASSERT(ohash_init(&hash, value_hash, value_less, NULL));
+  memset(present, 0, sizeof present);
+  for (op = 0; op < size * 16; op++)
+  {
+    struct value *v = &values[random_ulong() % size];
+
+    switch (random_ulong() % 4)
+    {
+    case 0:
+      ASSERT((ohash_insert(&hash, &v->elem) != NULL) == present[v->value]);
+      break;
+    case 1:
+      ASSERT((ohash_replace(&hash, &v->elem) != NULL) == present[v->value]);
+      break;
+    case 2:
+      ASSERT((ohash_find(&hash, &v->elem) != NULL) == present[v->value]);
+      continue;
+    default:
+      ASSERT((ohash_delete(&hash, &v->elem) != NULL) == present[v->value]);
+      if (present[v->value])
+        cnt--;
+      present[v->value] = false;
+      ASSERT(ohash_size(&hash) == cnt);
+      continue;
+    }
+    if (!present[v->value])
+      cnt++;
+    present[v->value] = true;
+    ASSERT(ohash_size(&hash) == cnt);
+  }
+
+  /* A reserved table keeps its elements. */
+  ASSERT(ohash_reserve(&hash, MAX_SIZE));
+  ASSERT(ohash_size(&hash) == cnt);
+
+  ohash_first(&i, &hash);
+  while (ohash_next(&i))
+  {
+    struct value *v = hash_entry(ohash_cur(&i), struct value, elem);
+    ASSERT(present[v->value]);
+    present[v->value] = false;
+    cnt--;
+  }
+  ASSERT(cnt == 0);
+
+  ohash_destroy(&hash, NULL);
+}
+
+/* Returns a hash of value E. */
+static uint64_t
+value_hash(const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int(hash_entry(e, struct value, elem)->value);
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less(const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct value *a = hash_entry(a_, struct value, elem);
+  const struct value *b = hash_entry(b_, struct value, elem);
+
+  return a->value < b->value;
+}
@@ -0,0 +1,139 @@
+#undef NDEBUG
+#include <debug.h>
+#include <heap.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a heap that we will test. */
+#define MAX_SIZE 64
+
+/* A heap element. */
+struct value
+{
+  struct heap_elem elem; /* Heap element. */
+  int value;             /* Item value. */
+};
+
+static void shuffle(struct value[], size_t);
+static bool value_less(const struct heap_elem *, const struct heap_elem *,
+                       void *);
+static size_t verify_heap(struct heap *, struct heap_elem *,
+                          struct heap_elem *);
+
+/* Test the binary heap implementation. */
+void test(void)
+{
+  int size;
+
+  printf("testing various size heaps:");
+  for (size = 0; size < MAX_SIZE; size++)
+  {
+    int repeat;
+
+    printf(" %d", size);
+    for (repeat = 0; repeat < 10; repeat++)
+    {
+      static struct value values[MAX_SIZE];
+      struct heap heap;
+      int i, removed;
+
+      /* Put values 0...SIZE in random order in VALUES. */
+      for (i = 0; i < size; i++)
+        values[i].value = i;
+      shuffle(values, size);
+
+      /* Assemble heap and verify it. */
+      heap_init(&heap, value_less, NULL);
+      for (i = 0; i < size; i++)
+      {
+        heap_push(&heap, &values[i].elem);
+        ASSERT(verify_heap(&heap, heap.root, NULL) == (size_t)i + 1);
+      }
+      if (size > 0)
+      {
+        ASSERT(heap_entry(heap_min(&heap), struct value, elem)->value == 0);
+      }
+
+      /* Change some keys, then remove a few elements from the
+         middle. */
+      for (i = 0; i < size; i++)
+        if (random_ulong() % 4 == 0)
+        {
+          values[i].value = random_ulong() % MAX_SIZE;
+          heap_update(&heap, &values[i].elem);
+          ASSERT(verify_heap(&heap, heap.root, NULL) == (size_t)size);
+        }
+      for (i = removed = 0; i < size; i++)
+        if (random_ulong() % 4 == 0)
+        {
+          heap_remove(&heap, &values[i].elem);
+          removed++;
+          ASSERT(verify_heap(&heap, heap.root, NULL)
+                 == (size_t)(size - removed));
+        }
+
+      /* Drain the heap in ascending order. */
+      for (i = -1; !heap_empty(&heap);)
+      {
+        struct value *v = heap_entry(heap_pop(&heap), struct value, elem);
+        ASSERT(v->value >= i);
+        i = v->value;
+        removed++;
+        verify_heap(&heap, heap.root, NULL);
+      }
+      ASSERT(removed == size);
+      ASSERT(heap_size(&heap) == 0);
+    }
+  }
+
+  printf(" done\n");
+  printf("heap: PASS\n");
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle(struct value *array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+  {
+    size_t j = i + random_ulong() % (cnt - i);
+    struct value t = array[j];
+    array[j] = array[i];
+    array[i] = t;
+  }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less(const struct heap_elem *a_, const struct heap_elem *b_,
+           void *aux UNUSED)
+{
+  const struct value *a = heap_entry(a_, struct value, elem);
+  const struct value *b = heap_entry(b_, struct value, elem);
+
+  return a->value < b->value;
+}
+
+/* Verifies the links and ordering of the subtree of HEAP rooted
+   at E, whose parent must be PARENT, and returns its number of
+   elements.  Called on the root, also verifies the element
+   count. */
+static size_t
+verify_heap(struct heap *heap, struct heap_elem *e, struct heap_elem *parent)
+{
+  size_t cnt;
+
+  if (e == NULL)
+    return 0;
+
+  ASSERT(e->parent == parent);
+  ASSERT(parent == NULL || !value_less(e, parent, NULL));
+
+  cnt = 1 + verify_heap(heap, e->left, e) + verify_heap(heap, e->right, e);
+  ASSERT(parent != NULL || cnt == heap_size(heap));
+  return cnt;
+}
@@ -0,0 +1,178 @@
+#undef NDEBUG
+#include <debug.h>
+#include <rbtree.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a tree that we will test. */
+#define MAX_SIZE 64
+
+/* A tree element. */
+struct value
+{
+  struct rb_elem elem; /* Tree element. */
+  int value;           /* Item value. */
+  int seq;             /* Insertion order among equal values. */
+};
+
+static void shuffle(struct value[], size_t);
+static bool value_less(const struct rb_elem *, const struct rb_elem *,
+                       void *);
+static int verify_tree(struct rb_elem *, struct rb_elem *);
+static void verify_order(struct rbtree *, int size);
+
+/* Test the red-black tree implementation. */
+void test(void)
+{
+  int size;
+
+  printf("testing various size trees:");
+  for (size = 0; size < MAX_SIZE; size++)
+  {
+    int repeat;
+
+    printf(" %d", size);
+    for (repeat = 0; repeat < 10; repeat++)
+    {
+      static struct value values[MAX_SIZE * 2];
+      struct value key;
+      struct rbtree tree;
+      struct rb_elem *e;
+      int i;
+
+      /* Put values 0...SIZE in random order in VALUES, each one
+         twice. */
+      for (i = 0; i < size * 2; i++)
+        values[i].value = i / 2;
+      shuffle(values, size * 2);
+
+      /* Assemble tree and verify it. */
+      rb_init(&tree, value_less, NULL);
+      for (i = 0; i < size * 2; i++)
+      {
+        values[i].seq = i;
+        rb_insert(&tree, &values[i].elem);
+      }
+      ASSERT(rb_size(&tree) == (size_t)size * 2);
+      verify_tree(tree.root, NULL);
+      verify_order(&tree, size);
+
+      /* Verify lookups and range bounds. */
+      for (i = 0; i < size; i++)
+      {
+        struct value *lo, *hi;
+
+        key.value = i;
+        lo = rb_entry(rb_lower_bound(&tree, &key.elem), struct value, elem);
+        ASSERT(lo->value == i);
+        ASSERT(rb_find(&tree, &key.elem) == &lo->elem);
+        e = rb_next(rb_next(&lo->elem));
+        ASSERT(rb_upper_bound(&tree, &key.elem) == e);
+        if (e != rb_end(&tree))
+        {
+          hi = rb_entry(e, struct value, elem);
+          ASSERT(hi->value == i + 1);
+        }
+      }
+      key.value = size;
+      ASSERT(rb_find(&tree, &key.elem) == NULL);
+      ASSERT(rb_lower_bound(&tree, &key.elem) == rb_end(&tree));
+
+      /* Remove about half the elements in random order,
+         verifying the tree as we go. */
+      for (i = 0; i < size * 2; i++)
+        if (random_ulong() % 2)
+        {
+          rb_remove(&tree, &values[i].elem);
+          verify_tree(tree.root, NULL);
+        }
+
+      /* Drain the tree in ascending order. */
+      for (i = -1; !rb_empty(&tree);)
+      {
+        struct value *v = rb_entry(rb_pop_min(&tree), struct value, elem);
+        ASSERT(v->value >= i);
+        i = v->value;
+        verify_tree(tree.root, NULL);
+      }
+      ASSERT(rb_size(&tree) == 0);
+      ASSERT(rb_begin(&tree) == rb_end(&tree));
+    }
+  }
+
+  printf(" done\n");
+  printf("rbtree: PASS\n");
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle(struct value *array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+  {
+    size_t j = i + random_ulong() % (cnt - i);
+    struct value t = array[j];
+    array[j] = array[i];
+    array[i] = t;
+  }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less(const struct rb_elem *a_, const struct rb_elem *b_,
+           void *aux UNUSED)
+{
+  const struct value *a = rb_entry(a_, struct value, elem);
+  const struct value *b = rb_entry(b_, struct value, elem);
+
+  return a->value < b->value;
+}
+
+/* Verifies the red-black properties of the subtree rooted at E,
+   whose parent must be PARENT, and returns its black height. */
+static int
+verify_tree(struct rb_elem *e, struct rb_elem *parent)
+{
+  int left, right;
+
+  if (e == NULL)
+    return 1;
+
+  ASSERT(e->parent == parent);
+  ASSERT(parent != NULL || !e->red);
+  ASSERT(!e->red || !parent->red);
+
+  left = verify_tree(e->left, e);
+  right = verify_tree(e->right, e);
+  ASSERT(left == right);
+  return left + !e->red;
+}
+
+/* Verifies that TREE holds each of the values 0...SIZE twice, in
+   ascending order both ways, with equal values in insertion
+   order. */
+static void
+verify_order(struct rbtree *tree, int size)
+{
+  struct rb_elem *e;
+  int i;
+
+  for (i = 0, e = rb_begin(tree); e != rb_end(tree); i++, e = rb_next(e))
+  {
+    struct value *v = rb_entry(e, struct value, elem);
+    ASSERT(v->value == i / 2);
+    if (i % 2)
+    {
+      ASSERT(v->seq > rb_entry(rb_prev(e), struct value, elem)->seq);
+    }
+  }
+  ASSERT(i == size * 2);
+
+  for (i = size * 2, e = rb_rbegin(tree); e != rb_end(tree); e = rb_prev(e))
+    ASSERT(rb_entry(e, struct value, elem)->value == --i / 2);
+  ASSERT(i == 0);
+}
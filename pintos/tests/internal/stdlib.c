@@ -11,6 +11,7 @@
 #include <debug.h>
 #include <limits.h>
 #include <random.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "threads/test.h"
@@ -22,6 +23,8 @@ static void shuffle (int[], size_t);
 static int compare_ints (const void *, const void *);
 static void verify_order (const int[], size_t);
 static void verify_bsearch (const int[], size_t);
+static void test_wide (void);
+static void test_radix (void);
 
 /* Test sorting and searching implementations. */
 void
@@ -34,7 +37,7 @@ test (void)
     {
       int repeat;
 
-      printf (" %zu", cnt);
+      printf (" %d", cnt);
       for (repeat = 0; repeat < 10; repeat++) 
         {
           static int values[MAX_CNT];
@@ -53,6 +56,9 @@ test (void)
     }
   
   printf (" done\n");
+
+  test_wide ();
+  test_radix ();
   printf ("stdlib: PASS\n");
 }
 
@@ -112,3 +118,82 @@ verify_bsearch (const int *array, size_t cnt)
     ASSERT (bsearch (&not_in_array[i], array, cnt, sizeof *array, compare_ints)
             == NULL);
 }
+
+/* An element too wide for the 4- and 8-byte swap routines. */
+struct wide
+  {
+    uint64_t key;
+    uint64_t check;
+  };
+
+/* Compares struct wides A and B by key. */
+static int
+compare_wide (const void *a_, const void *b_, void *aux UNUSED) 
+{
+  const struct wide *a = a_;
+  const struct wide *b = b_;
+
+  return a->key < b->key ? -1 : a->key > b->key;
+}
+
+/* Sorts arrays of 16-byte elements with many duplicate keys and
+   checks that the elements moved intact. */
+static void
+test_wide (void) 
+{
+  static struct wide values[MAX_CNT];
+  size_t i;
+
+  printf ("testing wide elements with duplicate keys\n");
+  for (i = 0; i < MAX_CNT; i++)
+    {
+      values[i].key = random_ulong () % 16;
+      values[i].check = ~values[i].key;
+    }
+  sort (values, MAX_CNT, sizeof *values, compare_wide, NULL);
+  for (i = 0; i < MAX_CNT; i++)
+    {
+      ASSERT (values[i].check == ~values[i].key);
+      ASSERT (i == 0 || values[i - 1].key <= values[i].key);
+    }
+
+  /* Sorting sorted input must not take quadratic time. */
+  sort (values, MAX_CNT, sizeof *values, compare_wide, NULL);
+  for (i = 1; i < MAX_CNT; i++)
+    ASSERT (values[i - 1].key <= values[i].key);
+}
+
+/* Checks radix_sort_u8() and radix_sort_u32() against the byte
+   and integer histograms of their input. */
+static void
+test_radix (void) 
+{
+  static uint32_t values[MAX_CNT], tmp[MAX_CNT];
+  static uint8_t bytes[MAX_CNT];
+  uint32_t sum = 0, xor = 0;
+  size_t i;
+
+  printf ("testing radix sorts\n");
+  for (i = 0; i < MAX_CNT; i++)
+    {
+      values[i] = random_ulong ();
+      if (i % 3 == 0)
+        values[i] &= 0xff00ff;
+      sum += values[i];
+      xor ^= values[i];
+      bytes[i] = values[i];
+    }
+
+  radix_sort_u32 (values, tmp, MAX_CNT);
+  for (i = 0; i < MAX_CNT; i++)
+    {
+      ASSERT (i == 0 || values[i - 1] <= values[i]);
+      sum -= values[i];
+      xor ^= values[i];
+    }
+  ASSERT (sum == 0 && xor == 0);
+
+  radix_sort_u8 (bytes, MAX_CNT);
+  for (i = 1; i < MAX_CNT; i++)
+    ASSERT (bytes[i - 1] <= bytes[i]);
+}
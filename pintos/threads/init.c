@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "devices/kbd.h"
+#include "devices/pmu.h"
 #include "devices/input.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
@@ -19,8 +20,11 @@
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/vmalloc.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -28,6 +32,7 @@
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #endif
+#include "tests/bench/bench.h"
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
@@ -86,6 +91,9 @@ int main(void)
 	mem_end = palloc_init();
 	malloc_init();
 	paging_init(mem_end);
+	vmalloc_init();
+	profile_init();
+	pmu_init();
 
 #ifdef USERPROG
 	tss_init();
@@ -101,9 +109,14 @@ int main(void)
 	exception_init();
 	syscall_init();
 #endif
+	/* Start worker threads, so that the timer interrupt can hand
+		 them delayed work as soon as interrupts are on. */
+	workqueue_init();
+
 	/* Start thread scheduler and enable interrupts. */
 	thread_start();
 	serial_init_queue();
+	console_start();
 	timer_calibrate();
 
 #ifdef FILESYS
@@ -228,6 +241,10 @@ parse_options(char **argv)
 			random_init(atoi(value));
 		else if (!strcmp(name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp(name, "-profile"))
+			profile_enabled = true;
+		else if (!strcmp(name, "-loglevel"))
+			console_set_loglevel(atoi(value));
 #ifdef USERPROG
 		else if (!strcmp(name, "-ul"))
 			user_page_limit = atoi(value);
@@ -251,14 +268,16 @@ run_task(char **argv)
 #ifdef USERPROG
 	if (thread_tests)
 	{
-		run_test(task);
+		if (!run_bench(task))
+			run_test(task);
 	}
 	else
 	{
 		process_wait(process_create_initd(task));
 	}
 #else
-	run_test(task);
+	if (!run_bench(task))
+		run_test(task);
 #endif
 	printf("Execution of '%s' complete.\n", task);
 }
@@ -340,6 +359,8 @@ usage(void)
 				 "  -f                 Format file system disk during startup.\n"
 				 "  -rs=SEED           Set random number seed to SEED.\n"
 				 "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+				 "  -profile           Sample the kernel on each timer tick.\n"
+				 "  -loglevel=LEVEL    Only show console lines below log LEVEL.\n"
 #ifdef USERPROG
 				 "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -351,11 +372,13 @@ usage(void)
 	 as long as we're running on Bochs or QEMU. */
 void power_off(void)
 {
+	console_sync();
 #ifdef FILESYS
 	filesys_done();
 #endif
 
 	print_stats();
+	profile_dump();
 
 	printf("Powering off...\n");
 	outw(0x604, 0x2000); /* Poweroff command for qemu */
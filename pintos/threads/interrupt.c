@@ -13,6 +13,7 @@
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #endif
 
 /* Number of x86_64 interrupts. */
@@ -140,8 +141,9 @@ intr_enable (void) {
 	/* Enable interrupts by setting the interrupt flag.
 
 	   See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
-	   Hardware Interrupts". */
-	asm volatile ("sti");
+	   Hardware Interrupts".  The memory clobber keeps the compiler
+	   from sinking stores made with interrupts off past this point. */
+	asm volatile ("sti" : : : "memory");
 
 	return old_level;
 }
@@ -372,6 +374,13 @@ intr_handler (struct intr_frame *frame) {
 		if (yield_on_return)
 			thread_yield ();
 	}
+
+#ifdef USERPROG
+	/* A thread of an exiting process dies on its way back to user
+	   mode. */
+	if (frame->cs == SEL_UCSEG && process_exiting ())
+		thread_exit ();
+#endif
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
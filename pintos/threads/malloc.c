@@ -13,32 +13,43 @@
 
    The size of each request, in bytes, is rounded up to a power
    of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
-
-   When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   that size.  Blocks are carved out of pages of memory, called
+   "arenas", obtained from the page allocator (if none is
+   available, malloc() returns a null pointer).
+
+   Each arena keeps its own free blocks: a list of blocks that
+   were freed, and a bump index below which every block has been
+   handed out at least once.  A new arena therefore starts with
+   an empty list and a zero index, without touching its blocks.
+   The descriptor keeps the arenas that have free blocks on its
+   partial list, and the arenas that have none on its full list.
+   A request is satisfied from the first partial arena, from its
+   free list if possible and otherwise by bumping the index.
+
+   When we free a block, we push it on its arena's free list,
+   which keeps frees to the same arena within the cache line of
+   its header.  If the arena now has no in-use blocks, it is
+   taken off the partial list and either kept as the
+   descriptor's one spare empty arena, for the next time the
+   partial list runs dry, or given back to the page allocator.
+   Either way, that takes constant time.
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.  realloc()
+   grows such a block in place if the pages after it are free.
+   See vmalloc.h for large buffers that need not be physically
+   contiguous. */
 
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
-	struct list free_list;      /* List of free blocks. */
+	struct list partial;        /* Arenas with free and used blocks. */
+	struct list full;           /* Arenas with no free blocks. */
+	struct arena *empty;        /* Spare arena with no used blocks. */
 	struct lock lock;           /* Lock. */
 };
 
@@ -50,11 +61,14 @@ struct arena {
 	unsigned magic;             /* Always set to ARENA_MAGIC. */
 	struct desc *desc;          /* Owning descriptor, null for big block. */
 	size_t free_cnt;            /* Free blocks; pages in big block. */
+	size_t bump_idx;            /* First block never handed out. */
+	struct block *free_list;    /* Freed blocks, most recent first. */
+	struct list_elem elem;      /* Descriptor's partial or full list. */
 };
 
 /* Free block. */
 struct block {
-	struct list_elem free_elem; /* Free list element. */
+	struct block *next;         /* Next block in arena's free list. */
 };
 
 /* Our set of descriptors. */
@@ -63,6 +77,7 @@ static size_t desc_cnt;         /* Number of descriptors. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void arena_init (struct arena *, struct desc *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -74,7 +89,9 @@ malloc_init (void) {
 		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
 		d->block_size = block_size;
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-		list_init (&d->free_list);
+		list_init (&d->partial);
+		list_init (&d->full);
+		d->empty = NULL;
 		lock_init (&d->lock);
 	}
 }
@@ -114,31 +131,38 @@ malloc (size_t size) {
 
 	lock_acquire (&d->lock);
 
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
-
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
-			lock_release (&d->lock);
-			return NULL;
-		}
-
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
+	/* If no arena has a free block, use the spare empty arena or
+	   create a new one. */
+	if (list_empty (&d->partial)) {
+		if (d->empty != NULL) {
+			a = d->empty;
+			d->empty = NULL;
+		} else {
+			/* Allocate a page. */
+			a = palloc_get_page (0);
+			if (a == NULL) {
+				lock_release (&d->lock);
+				return NULL;
+			}
+			arena_init (a, d);
 		}
+		list_push_front (&d->partial, &a->elem);
 	}
 
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
+	/* Get a block from the first partial arena, preferring
+	   recently freed blocks over untouched ones. */
+	a = list_entry (list_front (&d->partial), struct arena, elem);
+	if (a->free_list != NULL) {
+		b = a->free_list;
+		a->free_list = b->next;
+	} else
+		b = arena_to_block (a, a->bump_idx++);
+
+	/* Retire the arena to the full list once it runs out. */
+	if (--a->free_cnt == 0) {
+		list_remove (&a->elem);
+		list_push_back (&d->full, &a->elem);
+	}
 	lock_release (&d->lock);
 	return b;
 }
@@ -173,6 +197,35 @@ block_size (void *block) {
 	return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
 }
 
+/* Tries to resize OLD_BLOCK to NEW_SIZE bytes without moving
+   it.  A block from a descriptor stays put as long as NEW_SIZE
+   maps to the same descriptor.  A big block stays put as long as
+   it remains big: shrinking gives its trailing pages back, and
+   growing claims the pages after it if they are free.  Returns
+   true if successful. */
+static bool
+resize_in_place (void *old_block, size_t new_size) {
+	struct arena *a = block_to_arena (old_block);
+	struct desc *d = a->desc;
+	size_t page_cnt;
+
+	if (d != NULL)
+		return new_size <= d->block_size
+			&& (d == descs || new_size > d[-1].block_size);
+
+	if (new_size <= descs[desc_cnt - 1].block_size)
+		return false;
+
+	page_cnt = DIV_ROUND_UP (new_size + sizeof *a, PGSIZE);
+	if (page_cnt <= a->free_cnt)
+		palloc_free_multiple ((uint8_t *) a + page_cnt * PGSIZE,
+				a->free_cnt - page_cnt);
+	else if (!palloc_extend (a, a->free_cnt, page_cnt))
+		return false;
+	a->free_cnt = page_cnt;
+	return true;
+}
+
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
    moving it in the process.
    If successful, returns the new block; on failure, returns a
@@ -184,7 +237,9 @@ realloc (void *old_block, size_t new_size) {
 	if (new_size == 0) {
 		free (old_block);
 		return NULL;
-	} else {
+	} else if (old_block != NULL && resize_in_place (old_block, new_size))
+		return old_block;
+	else {
 		void *new_block = malloc (new_size);
 		if (old_block != NULL && new_block != NULL) {
 			size_t old_size = block_size (old_block);
@@ -215,19 +270,26 @@ free (void *p) {
 
 			lock_acquire (&d->lock);
 
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
+			/* Add block to its arena's free list. */
+			b->next = a->free_list;
+			a->free_list = b;
 
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
+			/* A full arena has a free block again. */
+			if (a->free_cnt++ == 0) {
+				list_remove (&a->elem);
+				list_push_front (&d->partial, &a->elem);
+			}
 
+			/* If the arena is now entirely unused, keep it as the
+			   spare or free it. */
+			if (a->free_cnt >= d->blocks_per_arena) {
 				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+				list_remove (&a->elem);
+				if (d->empty == NULL) {
+					arena_init (a, d);
+					d->empty = a;
+				} else
+					palloc_free_page (a);
 			}
 
 			lock_release (&d->lock);
@@ -256,6 +318,17 @@ block_to_arena (struct block *b) {
 	return a;
 }
 
+/* Initializes A as an arena of descriptor D with every block
+   free and none handed out yet. */
+static void
+arena_init (struct arena *a, struct desc *d) {
+	a->magic = ARENA_MAGIC;
+	a->desc = d;
+	a->free_cnt = d->blocks_per_arena;
+	a->bump_idx = 0;
+	a->free_list = NULL;
+}
+
 /* Returns the (IDX - 1)'th block within arena A. */
 static struct block *
 arena_to_block (struct arena *a, size_t idx) {
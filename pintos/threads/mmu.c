@@ -96,7 +96,7 @@ uint64_t *
 pml4_create (void) {
 	uint64_t *pml4 = palloc_get_page (0);
 	if (pml4)
-		memcpy (pml4, base_pml4, PGSIZE);
+		copy_page (pml4, base_pml4);
 	return pml4;
 }
 
@@ -275,7 +275,8 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 
 	if (pages) {
 		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
+			for (size_t i = 0; i < page_cnt; i++)
+				clear_page (pages + PGSIZE * i);
 	} else {
 		if (flags & PAL_ASSERT)
 			PANIC ("palloc_get: out of pages");
@@ -296,6 +297,41 @@ palloc_get_page (enum palloc_flags flags) {
 	return palloc_get_multiple (flags, 1);
 }
 
+/* Tries to grow the PAGE_CNT pages starting at PAGES, which were
+   obtained with palloc_get_multiple(), to NEW_CNT pages by
+   claiming the pages that follow them.  The new pages are not
+   zeroed.  Returns true if successful, false if any of those
+   pages is in use or outside the pool. */
+bool
+palloc_extend (void *pages, size_t page_cnt, size_t new_cnt) {
+	struct pool *pool;
+	size_t page_idx, extra_cnt;
+	bool success = false;
+
+	ASSERT (pg_ofs (pages) == 0);
+	ASSERT (new_cnt >= page_cnt);
+
+	if (page_from_pool (&kernel_pool, pages))
+		pool = &kernel_pool;
+	else if (page_from_pool (&user_pool, pages))
+		pool = &user_pool;
+	else
+		NOT_REACHED ();
+
+	page_idx = pg_no (pages) - pg_no (pool->base) + page_cnt;
+	extra_cnt = new_cnt - page_cnt;
+
+	lock_acquire (&pool->lock);
+	if (page_idx + extra_cnt <= bitmap_size (pool->used_map)
+			&& bitmap_none (pool->used_map, page_idx, extra_cnt)) {
+		bitmap_set_multiple (pool->used_map, page_idx, extra_cnt, true);
+		success = true;
+	}
+	lock_release (&pool->lock);
+
+	return success;
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
@@ -0,0 +1,178 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Sampling profiler.
+
+   On every timer tick, profile_sample() records where the
+   interrupted kernel code was: the interrupted rip, followed by
+   the return addresses found by walking the saved frame pointers
+   (the kernel is built with -fno-omit-frame-pointer).
+
+   profile_dump() prints each distinct call stack once, with the
+   number of samples that hit it, as lines of the form
+
+       Profile: COUNT PC CALLER CALLER...
+
+   which "backtrace -p" turns into a flat profile and a call
+   graph.  Ticks that interrupt user code are only counted. */
+
+/* Return addresses kept per sample, including the interrupted
+   rip. */
+#define PROFILE_DEPTH 8
+
+/* Pages of sample buffer. */
+#ifndef PROFILE_PAGES
+#define PROFILE_PAGES 64
+#endif
+
+/* One sample: a call stack, innermost first, ending at the first
+   null entry or after PROFILE_DEPTH entries. */
+struct sample {
+	uintptr_t pcs[PROFILE_DEPTH];
+};
+
+/* Sample buffer.  There is only one CPU, so one buffer; it is
+   only written by the timer interrupt. */
+struct profile_buffer {
+	struct sample *samples;     /* Recorded samples. */
+	size_t capacity;            /* Number of elements in SAMPLES. */
+	size_t cnt;                 /* Number of samples recorded. */
+	int64_t user;               /* Ticks in user code. */
+	int64_t lost;               /* Samples that did not fit. */
+};
+
+bool profile_enabled;
+static struct profile_buffer profile;
+
+/* Allocates the sample buffer, if profiling is enabled.  Must be
+   called after palloc_init(). */
+void
+profile_init (void) {
+	if (!profile_enabled)
+		return;
+
+	profile.samples = palloc_get_multiple (0, PROFILE_PAGES);
+	if (profile.samples == NULL) {
+		printf ("profile: no memory for sample buffer\n");
+		return;
+	}
+	profile.capacity = PROFILE_PAGES * PGSIZE / sizeof (struct sample);
+}
+
+/* Returns true if the two words at FRAME lie within the kernel
+   stack of thread T, below its top. */
+static bool
+frame_in_stack (struct thread *t, uintptr_t *frame) {
+	uintptr_t lo = (uintptr_t) (t + 1);
+	uintptr_t hi = (uintptr_t) t + PGSIZE;
+	uintptr_t p = (uintptr_t) frame;
+
+	return p >= lo && p <= hi - 2 * sizeof *frame
+		&& p % sizeof *frame == 0;
+}
+
+/* Records a sample of the code interrupted by the timer
+   interrupt with frame F. */
+void
+profile_sample (const struct intr_frame *f) {
+	struct thread *t = thread_current ();
+	struct sample *s;
+	uintptr_t *frame;
+	int depth;
+
+	if (profile.samples == NULL)
+		return;
+	if ((f->cs & 3) != 0) {
+		profile.user++;
+		return;
+	}
+	if (profile.cnt >= profile.capacity) {
+		profile.lost++;
+		return;
+	}
+
+	s = &profile.samples[profile.cnt++];
+	s->pcs[0] = f->rip;
+	depth = 1;
+
+	/* Each frame holds the caller's frame pointer, then the return
+	   address.  Frames only get older going up the stack, so stop
+	   at the first one that does not. */
+	for (frame = (uintptr_t *) f->R.rbp;
+			depth < PROFILE_DEPTH && frame_in_stack (t, frame) && frame[1] != 0;
+			frame = (uintptr_t *) frame[0]) {
+		s->pcs[depth++] = frame[1];
+		if (frame[0] <= (uintptr_t) frame)
+			break;
+	}
+	if (depth < PROFILE_DEPTH)
+		s->pcs[depth] = 0;
+}
+
+/* Orders samples A and B by their call stacks. */
+static int
+compare_samples (const void *a_, const void *b_) {
+	const struct sample *a = a_;
+	const struct sample *b = b_;
+	int i;
+
+	for (i = 0; i < PROFILE_DEPTH; i++) {
+		if (a->pcs[i] != b->pcs[i])
+			return a->pcs[i] < b->pcs[i] ? -1 : 1;
+		if (a->pcs[i] == 0)
+			break;
+	}
+	return 0;
+}
+
+/* Prints stack S, which was sampled CNT times. */
+static void
+print_sample (const struct sample *s, size_t cnt) {
+	int i;
+
+	printf ("Profile: %zu", cnt);
+	for (i = 0; i < PROFILE_DEPTH && s->pcs[i] != 0; i++)
+		printf (" %p", (void *) s->pcs[i]);
+	printf ("\n");
+}
+
+/* Stops sampling and prints the samples recorded, if profiling
+   is enabled.  Called when the machine powers off. */
+void
+profile_dump (void) {
+	struct sample *samples = profile.samples;
+	enum intr_level old_level;
+	size_t cnt, i, run;
+
+	if (samples == NULL)
+		return;
+
+	old_level = intr_disable ();
+	profile.samples = NULL;
+	cnt = profile.cnt;
+	intr_set_level (old_level);
+
+	printf ("Profile: %zu samples at %d Hz, %lld user, %lld lost.\n",
+			cnt, TIMER_FREQ, profile.user, profile.lost);
+
+	/* Sort so that identical stacks are adjacent, then print each
+	   distinct stack once with its count. */
+	qsort (samples, cnt, sizeof *samples, compare_samples);
+	for (i = 0; i < cnt; i += run) {
+		for (run = 1; i + run < cnt; run++)
+			if (compare_samples (&samples[i], &samples[i + run]) != 0)
+				break;
+		print_sample (&samples[i], run);
+	}
+	printf ("Profile: end.\n");
+
+	palloc_free_multiple (samples, PROFILE_PAGES);
+}
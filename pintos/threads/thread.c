@@ -1,4 +1,5 @@
 #include "threads/thread.h"
+#include <console.h>
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
@@ -22,6 +23,12 @@ static struct thread *idle_thread, *initial_thread; // idle 스레드와 최초(
 static struct lock tid_lock;												// TID 중복 방지를 위한 락
 static struct list dying_threads_queue;							// 종료 요청된 스레드(파괴 대기) 관리 리스트
 
+// 종료된 스레드의 페이지를 palloc에 돌려주지 않고 모아 두었다가 thread_create()에서 재사용한다
+// 0으로 채우는 비용과 palloc 잠금을 피하며, 커널 풀을 너무 많이 잡지 않도록 개수를 제한한다
+#define THREAD_CACHE_MAX 16
+static struct list thread_cache;										// 재사용 대기 중인 스레드 페이지 리스트
+static size_t thread_cache_cnt;											// thread_cache에 있는 페이지 수
+
 static long long idle_ticks;	 // idle 상태 동안 누적된 타이머 틱 수
 static long long kernel_ticks; // 커널 스레드가 실행된 동안 누적된 타이머 틱 수
 static long long user_ticks;	 // 유저 프로그램이 실행된 동안 누적된 타이머 틱 수
@@ -41,6 +48,8 @@ static void init_thread(struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule(void);
 static tid_t allocate_tid(void);
+static struct thread *thread_page_alloc(void);
+static void thread_page_free(struct thread *);
 
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC) // T가 올바른 스레드인가
 
@@ -64,6 +73,7 @@ void thread_init(void)
 	lock_init(&tid_lock);
 	list_init(&ready_list);
 	list_init(&dying_threads_queue);
+	list_init(&thread_cache);
 
 	// 현재 실행 중인 스레드 구조체 설정
 	initial_thread = running_thread();
@@ -131,6 +141,9 @@ void thread_tick(void)
 // 스레드 통계 정보를 출력
 void thread_print_stats(void)
 {
+	printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
+				 idle_ticks, kernel_ticks, user_ticks);
+	pmu_print_stats();
 }
 
 /**
@@ -160,8 +173,8 @@ tid_t thread_create(const char *name, int priority,
 	// 실행할 함수가 NULL이 아닌지 검증
 	ASSERT(function != NULL);
 
-	// 페이지 단위로 메모리를 할당하고 0으로 초기화
-	curr = palloc_get_page(PAL_ZERO);
+	// 스레드 페이지를 할당 (구조체는 init_thread()에서 초기화)
+	curr = thread_page_alloc();
 	if (curr == NULL)
 		return TID_ERROR;
 
@@ -255,6 +268,7 @@ void thread_exit(void)
 #ifdef USERPROG
 	process_exit();
 #endif
+	console_flush();
 
 	// 상태를 DYING으로 설정하고 다른 프로세스를 스케줄함
 	intr_disable();
@@ -436,8 +450,9 @@ bool compare_ready_priority(const struct list_elem *a, const struct list_elem *b
 	return thread_a->priority > thread_b->priority;
 }
 
-/* iretq 명령어를 사용하여 스레드를 실행 */
-void do_iret(struct intr_frame *tf)
+/* iretq 명령어를 사용하여 스레드를 실행.
+	thread_launch()의 인라인 어셈블리에서도 호출하므로 LTO가 제거하지 않도록 used로 표시한다. */
+__attribute__((used)) void do_iret(struct intr_frame *tf)
 {
 	__asm __volatile(
 			"movq %0, %%rsp\n"
@@ -517,7 +532,7 @@ static void thread_launch(struct thread *th)
 			"mov %%rcx, %%rdi\n"
 			"call do_iret\n"
 			"out_iret:\n"
-			: : "g"(tf_cur), "g"(tf) : "memory");
+			: : "a"(tf_cur), "c"(tf) : "memory");
 }
 
 /* 새로운 프로세스를 스케줄한다.
@@ -532,7 +547,7 @@ do_schedule(int status)
 	{
 		struct thread *victim =
 				list_entry(list_pop_front(&dying_threads_queue), struct thread, elem);
-		palloc_free_page(victim);
+		thread_page_free(victim);
 	}
 	thread_current()->status = status;
 	schedule();
@@ -566,11 +581,53 @@ schedule(void)
 			list_push_back(&dying_threads_queue, &curr->elem);
 		}
 
+		// 하드웨어 성능 카운터를 스레드별로 나눠 집계한다
+		pmu_switch(curr, next);
+
 		// 스레드 전환 전에 현재 실행 중인 정보를 저장한다
 		thread_launch(next);
 	}
 }
 
+/* 스레드 페이지를 하나 반환한다. thread_cache에 재사용할 페이지가 있으면 그것을,
+	없으면 palloc에서 0으로 채운 새 페이지를 반환한다.
+	재사용 페이지는 0으로 채우지 않는다. struct thread는 init_thread()가 memset으로
+	초기화하고, 나머지는 새로 쓰일 스택이므로 이전 내용이 남아 있어도 된다. */
+static struct thread *
+thread_page_alloc(void)
+{
+	struct thread *t = NULL;
+	enum intr_level old_level = intr_disable();
+
+	if (!list_empty(&thread_cache))
+	{
+		t = list_entry(list_pop_front(&thread_cache), struct thread, elem);
+		thread_cache_cnt--;
+	}
+	intr_set_level(old_level);
+
+	if (t == NULL)
+		t = palloc_get_page(PAL_ZERO);
+	return t;
+}
+
+/* 종료된 스레드 T의 페이지를 thread_cache에 넣는다. 캐시가 가득 차 있으면 palloc에 돌려준다.
+	인터럽트가 꺼진 상태에서 호출해야 한다. */
+static void
+thread_page_free(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (thread_cache_cnt < THREAD_CACHE_MAX)
+	{
+		t->magic = 0;
+		list_push_front(&thread_cache, &t->elem);
+		thread_cache_cnt++;
+	}
+	else
+		palloc_free_page(t);
+}
+
 // 새 스레드에 사용할 tid를 반환
 static tid_t
 allocate_tid(void)
@@ -585,7 +642,7 @@ allocate_tid(void)
 	return tid;
 }
 
-int thread_get_nice(void) {};
-void thread_set_nice(int) {};
-int thread_get_recent_cpu(void) {};
-int thread_get_load_avg(void) {};
+int thread_get_nice(void) { return 0; }
+void thread_set_nice(int nice UNUSED) {}
+int thread_get_recent_cpu(void) { return 0; }
+int thread_get_load_avg(void) { return 0; }
@@ -0,0 +1,175 @@
+#include "threads/vmalloc.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/init.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Virtually contiguous allocator.
+
+   malloc() hands out blocks bigger than about half a page as
+   runs of physically contiguous pages, which become hard to find
+   once the kernel pool is fragmented.  vmalloc() instead backs
+   an allocation with individual pages from the kernel pool,
+   wherever they are, and maps them at consecutive addresses in a
+   window of kernel virtual memory set aside for the purpose.
+
+   The window lies under the same top-level page table entry as
+   the kernel's own mapping, and every pml4 copies that entry
+   from base_pml4, so the lower-level tables are shared and a
+   mapping made here shows up in every address space at once.
+
+   Each allocation is followed by an unmapped guard page, which
+   catches overruns and marks the end of the allocation for
+   vfree().  Memory from vmalloc() is not in the kernel's linear
+   mapping of physical memory: vtop() gives wrong answers for it,
+   so hardware that needs physical addresses must be handed one
+   page at a time. */
+
+/* Window of kernel virtual memory for vmalloc(), far above the
+   linear mapping of physical memory at KERN_BASE. */
+#define VMALLOC_START (KERN_BASE + 0x4000000000)
+#define VMALLOC_PAGES (256 * 1024 * 1024 / PGSIZE)
+
+static struct lock vmalloc_lock;        /* Protects the fields below. */
+static struct bitmap *vmalloc_map;      /* Pages of the window in use. */
+static size_t vmalloc_hint;             /* Page to start searching at. */
+
+static void unmap_pages (uint8_t *start, size_t page_cnt);
+
+/* Initializes the vmalloc() window.  Must run after
+   paging_init(). */
+void
+vmalloc_init (void) {
+	ASSERT (base_pml4 != NULL);
+
+	lock_init (&vmalloc_lock);
+	vmalloc_map = bitmap_create (VMALLOC_PAGES);
+	if (vmalloc_map == NULL)
+		PANIC ("vmalloc_init: out of memory");
+}
+
+/* Obtains and returns a new block of at least SIZE bytes that is
+   contiguous in kernel virtual memory but not necessarily in
+   physical memory.  The block is page-aligned and is not zeroed.
+   Returns a null pointer if memory or address space is not
+   available. */
+void *
+vmalloc (size_t size) {
+	size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+	size_t idx, i;
+	uint8_t *start;
+
+	/* A null pointer satisfies a request for 0 bytes. */
+	if (size == 0)
+		return NULL;
+
+	lock_acquire (&vmalloc_lock);
+
+	/* Reserve the pages and the guard page after them. */
+	idx = bitmap_scan_hint (vmalloc_map, vmalloc_hint, page_cnt + 1, false);
+	if (idx == BITMAP_ERROR) {
+		lock_release (&vmalloc_lock);
+		return NULL;
+	}
+	bitmap_set_multiple (vmalloc_map, idx, page_cnt + 1, true);
+	vmalloc_hint = idx + page_cnt + 1;
+
+	/* Back each page with a frame of its own. */
+	start = (uint8_t *) VMALLOC_START + idx * PGSIZE;
+	for (i = 0; i < page_cnt; i++) {
+		void *kpage = palloc_get_page (0);
+		uint64_t *pte = NULL;
+
+		if (kpage != NULL)
+			pte = pml4e_walk (base_pml4, (uint64_t) (start + i * PGSIZE), 1);
+		if (pte == NULL) {
+			palloc_free_page (kpage);
+			unmap_pages (start, i);
+			bitmap_set_multiple (vmalloc_map, idx, page_cnt + 1, false);
+			lock_release (&vmalloc_lock);
+			return NULL;
+		}
+		*pte = vtop (kpage) | PTE_P | PTE_W;
+	}
+
+	lock_release (&vmalloc_lock);
+	return start;
+}
+
+/* Allocates and returns A times B bytes initialized to zeroes,
+   as vmalloc() does.  Returns a null pointer if memory is not
+   available. */
+void *
+vcalloc (size_t a, size_t b) {
+	void *p;
+	size_t size;
+
+	/* Calculate block size and make sure it fits in size_t. */
+	size = a * b;
+	if (a != 0 && size / a != b)
+		return NULL;
+
+	/* Allocate and zero memory. */
+	p = vmalloc (size);
+	if (p != NULL)
+		memset (p, 0, size);
+
+	return p;
+}
+
+/* Frees block P, which must have been previously allocated with
+   vmalloc() or vcalloc(). */
+void
+vfree (void *p) {
+	uint8_t *start = p;
+	size_t idx, page_cnt;
+
+	if (p == NULL)
+		return;
+
+	ASSERT (pg_ofs (p) == 0);
+	ASSERT ((uint64_t) p >= VMALLOC_START
+			&& (uint64_t) p < VMALLOC_START + (uint64_t) VMALLOC_PAGES * PGSIZE);
+
+	lock_acquire (&vmalloc_lock);
+
+	/* The allocation ends at its unmapped guard page. */
+	for (page_cnt = 0; ; page_cnt++) {
+		uint64_t *pte = pml4e_walk (base_pml4,
+				(uint64_t) (start + page_cnt * PGSIZE), 0);
+		if (pte == NULL || !(*pte & PTE_P))
+			break;
+	}
+	ASSERT (page_cnt > 0);
+
+	unmap_pages (start, page_cnt);
+	idx = (start - (uint8_t *) VMALLOC_START) / PGSIZE;
+	bitmap_set_multiple (vmalloc_map, idx, page_cnt + 1, false);
+
+	lock_release (&vmalloc_lock);
+}
+
+/* Unmaps the PAGE_CNT pages starting at START and frees the
+   frames behind them.  The page tables themselves are kept for
+   later allocations. */
+static void
+unmap_pages (uint8_t *start, size_t page_cnt) {
+	size_t i;
+
+	for (i = 0; i < page_cnt; i++) {
+		uint8_t *va = start + i * PGSIZE;
+		uint64_t *pte = pml4e_walk (base_pml4, (uint64_t) va, 0);
+
+		ASSERT (pte != NULL && (*pte & PTE_P));
+		palloc_free_page (ptov (PTE_ADDR (*pte)));
+		*pte = 0;
+		invlpg ((uint64_t) va);
+	}
+}
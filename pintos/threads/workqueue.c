@@ -0,0 +1,332 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* Workqueues.
+
+   A work item is a function call to be made later by a kernel
+   thread.  queue_work() adds an item to a workqueue, whose pool
+   of worker threads take items off the queue in order and run
+   them at the queue's priority.  queue_delayed_work() first
+   parks the item on a list sorted by expiry tick, and the timer
+   interrupt moves it onto its queue when the tick comes.
+
+   Queueing and cancelling never sleep, so they may be called
+   from interrupt handlers, which is how an interrupt hands work
+   that may block off to a thread.  All workqueue state is
+   therefore protected by disabling interrupts rather than by
+   locks.
+
+   A work item must not be touched by the workqueue after its
+   function returns, since the function may free it.  Workers
+   remember the item they are running only by address, for the
+   benefit of flush_work(). */
+
+/* A worker thread. */
+struct worker {
+	struct workqueue *wq;       /* Queue served. */
+	struct work *current;       /* Work being run, or null. */
+};
+
+/* A queue of work and the threads that run it. */
+struct workqueue {
+	const char *name;           /* Name, for worker threads. */
+	struct list pending;        /* Work waiting to run. */
+	struct list idle;           /* Workers waiting for work. */
+	struct list flushers;       /* Threads in flush_work(). */
+	bool dying;                 /* Workers exit instead of waiting. */
+	size_t worker_cnt;          /* Number of workers. */
+	struct worker workers[];    /* Workers. */
+};
+
+/* Number of worker threads in system_wq. */
+#define SYSTEM_WQ_THREADS 2
+
+struct workqueue *system_wq;
+
+/* Delayed work, soonest first. */
+static struct list delayed_list;
+
+static void abandon (struct workqueue *, size_t started);
+static void worker_loop (void *);
+static void enqueue (struct workqueue *, struct work *);
+static void wake (struct thread *);
+static bool expires_less (const struct list_elem *,
+		const struct list_elem *, void *);
+
+/* Initializes the workqueue subsystem and creates system_wq.
+   Must run after malloc_init() and before the timer interrupt is
+   enabled. */
+void
+workqueue_init (void) {
+	list_init (&delayed_list);
+	system_wq = workqueue_create ("events", PRI_DEFAULT, SYSTEM_WQ_THREADS);
+	if (system_wq == NULL)
+		PANIC ("workqueue_init: out of memory");
+}
+
+/* Creates and returns a workqueue whose THREAD_CNT worker
+   threads run at PRIORITY.  Returns a null pointer if memory is
+   not available. */
+struct workqueue *
+workqueue_create (const char *name, int priority, size_t thread_cnt) {
+	struct workqueue *wq;
+	size_t i;
+
+	ASSERT (thread_cnt > 0);
+
+	wq = malloc (sizeof *wq + thread_cnt * sizeof *wq->workers);
+	if (wq == NULL)
+		return NULL;
+	wq->name = name;
+	list_init (&wq->pending);
+	list_init (&wq->idle);
+	list_init (&wq->flushers);
+	wq->dying = false;
+	wq->worker_cnt = thread_cnt;
+
+	for (i = 0; i < thread_cnt; i++) {
+		char thread_name[32];
+
+		wq->workers[i].wq = wq;
+		wq->workers[i].current = NULL;
+		snprintf (thread_name, sizeof thread_name, "%s/%zu", name, i);
+		if (thread_create (thread_name, priority, worker_loop,
+					&wq->workers[i]) == TID_ERROR) {
+			abandon (wq, i);
+			return NULL;
+		}
+	}
+	return wq;
+}
+
+/* Gives up on WQ, of which only the first STARTED workers are
+   running.  They exit as soon as they find the queue empty, and
+   the last one out frees WQ. */
+static void
+abandon (struct workqueue *wq, size_t started) {
+	enum intr_level old_level = intr_disable ();
+
+	wq->dying = true;
+	wq->worker_cnt = started;
+	while (!list_empty (&wq->idle))
+		thread_unblock (list_entry (list_pop_front (&wq->idle),
+					struct thread, elem));
+	intr_set_level (old_level);
+
+	if (started == 0)
+		free (wq);
+}
+
+/* Called by the timer interrupt handler at each tick NOW, to
+   queue delayed work that has come due. */
+void
+workqueue_tick (int64_t now) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (!list_empty (&delayed_list)) {
+		struct work *w = list_entry (list_front (&delayed_list),
+				struct work, elem);
+		if (w->expires > now)
+			break;
+		list_pop_front (&delayed_list);
+		enqueue (w->wq, w);
+	}
+}
+
+/* Initializes W to call FUNC with AUX. */
+void
+work_init (struct work *w, work_func *func, void *aux) {
+	ASSERT (w != NULL);
+	ASSERT (func != NULL);
+
+	w->func = func;
+	w->aux = aux;
+	w->wq = NULL;
+	w->expires = 0;
+	w->state = WORK_IDLE;
+}
+
+/* Queues W to run on WQ.  Returns true if successful, false if W
+   was already queued or delayed.  May be called from an
+   interrupt handler. */
+bool
+queue_work (struct workqueue *wq, struct work *w) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT (wq != NULL);
+	ASSERT (w != NULL);
+
+	old_level = intr_disable ();
+	if (w->state == WORK_IDLE) {
+		enqueue (wq, w);
+		queued = true;
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Queues W to run on WQ once TICKS timer ticks have passed.
+   Returns true if successful, false if W was already queued or
+   delayed.  May be called from an interrupt handler. */
+bool
+queue_delayed_work (struct workqueue *wq, struct work *w, int64_t ticks) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT (wq != NULL);
+	ASSERT (w != NULL);
+
+	if (ticks <= 0)
+		return queue_work (wq, w);
+
+	old_level = intr_disable ();
+	if (w->state == WORK_IDLE) {
+		w->wq = wq;
+		w->expires = timer_ticks () + ticks;
+		w->state = WORK_DELAYED;
+		list_insert_ordered (&delayed_list, &w->elem, expires_less, NULL);
+		queued = true;
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Takes W off its queue or the delayed list if it has not
+   started running.  Returns true if W was taken off, false if it
+   was not queued.  May be called from an interrupt handler.  W
+   may still be running when this returns; use flush_work() to
+   wait for it. */
+bool
+cancel_work (struct work *w) {
+	enum intr_level old_level;
+	bool cancelled = false;
+
+	ASSERT (w != NULL);
+
+	old_level = intr_disable ();
+	if (w->state != WORK_IDLE) {
+		list_remove (&w->elem);
+		w->state = WORK_IDLE;
+		cancelled = true;
+	}
+	intr_set_level (old_level);
+	return cancelled;
+}
+
+/* Returns true if W is queued, delayed, or running. */
+static bool
+work_busy (struct work *w) {
+	size_t i;
+
+	if (w->state != WORK_IDLE)
+		return true;
+	if (w->wq != NULL)
+		for (i = 0; i < w->wq->worker_cnt; i++)
+			if (w->wq->workers[i].current == w)
+				return true;
+	return false;
+}
+
+/* Waits until W has finished running, if it is queued or
+   running.  Delayed work is queued at once instead of waiting
+   for its tick.  Must not be called from W itself. */
+void
+flush_work (struct work *w) {
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+	ASSERT (w != NULL);
+
+	old_level = intr_disable ();
+	if (w->state == WORK_DELAYED) {
+		list_remove (&w->elem);
+		enqueue (w->wq, w);
+	}
+	while (work_busy (w)) {
+		list_push_back (&w->wq->flushers, &thread_current ()->elem);
+		thread_block ();
+	}
+	intr_set_level (old_level);
+}
+
+/* Body of a worker thread: runs work from its queue, one item
+   at a time, until the queue is abandoned. */
+static void
+worker_loop (void *worker_) {
+	struct worker *worker = worker_;
+	struct workqueue *wq = worker->wq;
+
+	intr_disable ();
+	for (;;) {
+		struct work *w;
+		struct list_elem *e;
+
+		while (list_empty (&wq->pending)) {
+			if (wq->dying) {
+				bool last = --wq->worker_cnt == 0;
+				intr_enable ();
+				if (last)
+					free (wq);
+				thread_exit ();
+			}
+			list_push_back (&wq->idle, &thread_current ()->elem);
+			thread_block ();
+		}
+		w = list_entry (list_pop_front (&wq->pending), struct work, elem);
+		w->state = WORK_IDLE;
+		worker->current = w;
+
+		intr_enable ();
+		w->func (w->aux);
+		intr_disable ();
+
+		/* W may be gone by now. */
+		worker->current = NULL;
+		while (!list_empty (&wq->flushers)) {
+			e = list_pop_front (&wq->flushers);
+			thread_unblock (list_entry (e, struct thread, elem));
+		}
+		preemption_by_priority ();
+	}
+}
+
+/* Puts W at the end of WQ's queue and wakes up a worker for it.
+   Interrupts must be off. */
+static void
+enqueue (struct workqueue *wq, struct work *w) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	w->wq = wq;
+	w->state = WORK_QUEUED;
+	list_push_back (&wq->pending, &w->elem);
+	if (!list_empty (&wq->idle))
+		wake (list_entry (list_pop_front (&wq->idle), struct thread, elem));
+}
+
+/* Unblocks T, yielding to it if it should preempt the running
+   thread.  Inside an interrupt handler the yield happens as the
+   handler returns. */
+static void
+wake (struct thread *t) {
+	thread_unblock (t);
+	if (!intr_context ())
+		preemption_by_priority ();
+	else if (t->priority > thread_current ()->priority)
+		intr_yield_on_return ();
+}
+
+/* Orders delayed work by expiry tick. */
+static bool
+expires_less (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct work *a = list_entry (a_, struct work, elem);
+	const struct work *b = list_entry (b_, struct work, elem);
+
+	return a->expires < b->expires;
+}
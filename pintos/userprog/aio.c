@@ -0,0 +1,464 @@
+#include "userprog/aio.h"
+#include <aio.h>
+#include <debug.h>
+#include <list.h>
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "userprog/process.h"
+#include "userprog/shm.h"
+#include "userprog/syscall.h"
+
+/* Asynchronous I/O.
+
+   A process sets up a pair of rings with io_setup(), in a page
+   it shares with the kernel through shm_map_page(), and then
+   queues requests on the submission ring and hands them over in
+   batches with io_enter().  io_enter() takes each request off the
+   submission ring and queues it on aio_wq, whose worker threads
+   carry it out against the file system and post its result on
+   the completion ring.  One thread can thus keep several requests
+   going at once, and learns of their results without a system
+   call.
+
+   Workers never touch user memory, which the process may unmap
+   at any moment.  Each IO_READ and IO_WRITE moves its data
+   through a kernel bounce buffer of up to IO_LEN_MAX bytes.
+   io_enter() fills a write's buffer, and copies IO_OPEN's file
+   name, when it takes the request, running in the process.  A
+   finished read is parked on the ring until the next io_enter(),
+   which copies its data out to the user and only then posts its
+   completion.  All of these copies go through copy_from_user()
+   and copy_to_user(), so a buffer unmapped in the meantime fails
+   the request instead of the kernel.  aio_cleanup() waits for the
+   workers to finish with a ring before freeing it.
+
+   Completions never overflow, because io_enter() takes no more
+   requests than there is room for in the completion ring, counting
+   the ones already running.
+
+   Files opened with IO_OPEN are private to the ring.  The file
+   system has no locking of its own, so opening and closing files
+   happen under fs_lock, but reads and writes do not, so that the
+   disk driver sees several of them at once.  Writes reach the disk
+   before file_write_at() returns, so IO_FSYNC only has to wait
+   for the ring's writes still running. */
+
+/* Number of worker threads. */
+#define AIO_WORKERS 4
+
+/* Longest file name IO_OPEN accepts, including the null. */
+#define IO_PATH_MAX 128
+
+/* An I/O ring, the kernel side of a struct io_rings. */
+struct io_ring {
+	struct list_elem elem;      /* rings element. */
+	uint64_t *pml4;             /* Address space served. */
+	struct shm *shm;            /* Segment holding RINGS. */
+	struct io_rings *rings;     /* Shared rings, at a kernel address. */
+	uint32_t entries;           /* Entries in each ring. */
+	struct lock lock;           /* Protects the fields below. */
+	struct condition idle;      /* Signalled when a request completes. */
+	uint32_t sq_head;           /* Next submission to take. */
+	uint32_t cq_tail;           /* Next completion to fill. */
+	int inflight;               /* Requests taken but not completed. */
+	int running;                /* Those queued or running on aio_wq. */
+	int write_cnt;              /* IO_WRITEs among them. */
+	struct list fsyncs;         /* IO_FSYNCs waiting for those writes. */
+	struct list reads;          /* IO_READs waiting for io_enter(). */
+	struct file *files[IO_FILES_MAX]; /* Open files, by fd. */
+};
+
+/* A request taken off a submission ring. */
+struct io_req {
+	struct work work;           /* Runs io_execute(). */
+	struct list_elem elem;      /* io_ring's fsyncs or reads element. */
+	struct io_ring *ring;       /* Ring it came from. */
+	struct io_sqe sqe;          /* Copy of the submission. */
+	void *buf;                  /* Bounce buffer or file name, if any. */
+	int res;                    /* Result of a parked IO_READ. */
+};
+
+static struct lock aio_lock;    /* Protects the fields below. */
+static struct list rings;       /* All rings. */
+static struct workqueue *aio_wq; /* Worker threads, made on first use. */
+
+static struct lock fs_lock;     /* Serializes file opens and closes. */
+
+static struct io_ring *ring_find (uint64_t *pml4);
+static uint32_t cq_pending (struct io_ring *);
+static bool io_prepare (struct io_req *);
+static void io_execute (void *req_);
+static int io_do (struct io_ring *, struct io_req *);
+static void deliver_reads (struct io_ring *);
+static void io_complete (struct io_ring *, struct io_req *, int res);
+static void io_free (struct io_req *);
+
+/* Initializes asynchronous I/O. */
+void
+aio_init (void) {
+	lock_init (&aio_lock);
+	list_init (&rings);
+	lock_init (&fs_lock);
+}
+
+/* Sets up I/O rings of ENTRIES entries each for the running
+   process, in a page mapped at ADDR.  ENTRIES must be a power of
+   2 no greater than IO_ENTRIES_MAX.  Returns 0 if successful, -1
+   if the process already has rings or on failure. */
+int
+aio_setup (void *addr, unsigned entries) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	struct io_ring *ring = NULL;
+	void *kpage;
+
+	if (pml4 == NULL || entries == 0 || entries > IO_ENTRIES_MAX
+			|| (entries & (entries - 1)) != 0)
+		return -1;
+
+	lock_acquire (&aio_lock);
+	if (aio_wq == NULL)
+		aio_wq = workqueue_create ("aio", PRI_DEFAULT, AIO_WORKERS);
+	if (aio_wq != NULL && ring_find (pml4) == NULL)
+		ring = calloc (1, sizeof *ring);
+	if (ring != NULL) {
+		ring->shm = shm_map_page (addr, &kpage);
+		if (ring->shm == NULL) {
+			free (ring);
+			ring = NULL;
+		}
+	}
+	if (ring != NULL) {
+		ring->pml4 = pml4;
+		ring->rings = kpage;
+		ring->rings->entries = ring->entries = entries;
+		lock_init (&ring->lock);
+		cond_init (&ring->idle);
+		list_init (&ring->fsyncs);
+		list_init (&ring->reads);
+		list_push_back (&rings, &ring->elem);
+	}
+	lock_release (&aio_lock);
+	return ring != NULL ? 0 : -1;
+}
+
+/* Takes up to TO_SUBMIT requests off the running process's
+   submission ring and starts them, then waits until at least
+   MIN_COMPLETE completions are ready or nothing is left running.
+   Posts the completions of finished reads along the way.
+   Returns the number of requests taken, or -1 if the process has
+   no rings. */
+int
+aio_enter (unsigned to_submit, unsigned min_complete) {
+	struct io_ring *ring;
+	struct io_rings *r;
+	unsigned submitted = 0;
+
+	lock_acquire (&aio_lock);
+	ring = ring_find (thread_current ()->pml4);
+	lock_release (&aio_lock);
+	if (ring == NULL)
+		return -1;
+	r = ring->rings;
+
+	lock_acquire (&ring->lock);
+	while (submitted < to_submit) {
+		uint32_t tail = __atomic_load_n (&r->sq_tail, __ATOMIC_ACQUIRE);
+		struct io_req *req;
+
+		if (tail == ring->sq_head
+				|| ring->inflight + cq_pending (ring) >= ring->entries)
+			break;
+		req = malloc (sizeof *req);
+		if (req == NULL)
+			break;
+
+		req->ring = ring;
+		req->sqe = r->sqes[ring->sq_head & (ring->entries - 1)];
+		req->buf = NULL;
+		ring->sq_head++;
+		__atomic_store_n (&r->sq_head, ring->sq_head, __ATOMIC_RELEASE);
+
+		ring->inflight++;
+		submitted++;
+		if (!io_prepare (req)) {
+			io_complete (ring, req, -1);
+			continue;
+		}
+		ring->running++;
+		if (req->sqe.opcode == IO_WRITE)
+			ring->write_cnt++;
+		work_init (&req->work, io_execute, req);
+		queue_work (aio_wq, &req->work);
+	}
+
+	for (;;) {
+		deliver_reads (ring);
+		if (cq_pending (ring) >= min_complete || ring->inflight == 0
+				|| process_exiting ())
+			break;
+		cond_wait (&ring->idle, &ring->lock);
+	}
+	lock_release (&ring->lock);
+	return submitted;
+}
+
+/* Tears down the rings of the address space PML4, if any, once
+   the workers are done with them, and closes their files.  Reads
+   not yet delivered are dropped. */
+void
+aio_cleanup (uint64_t *pml4) {
+	struct io_ring *ring;
+	int fd;
+
+	lock_acquire (&aio_lock);
+	ring = ring_find (pml4);
+	if (ring != NULL)
+		list_remove (&ring->elem);
+	lock_release (&aio_lock);
+	if (ring == NULL)
+		return;
+
+	lock_acquire (&ring->lock);
+	while (ring->running > 0)
+		cond_wait (&ring->idle, &ring->lock);
+	lock_release (&ring->lock);
+	while (!list_empty (&ring->reads))
+		io_free (list_entry (list_pop_front (&ring->reads),
+					struct io_req, elem));
+	while (!list_empty (&ring->fsyncs))
+		io_free (list_entry (list_pop_front (&ring->fsyncs),
+					struct io_req, elem));
+
+	lock_acquire (&fs_lock);
+	for (fd = 0; fd < IO_FILES_MAX; fd++)
+		file_close (ring->files[fd]);
+	lock_release (&fs_lock);
+	shm_put (ring->shm);
+	free (ring);
+}
+
+/* Returns the rings of PML4, or a null pointer if it has none. */
+static struct io_ring *
+ring_find (uint64_t *pml4) {
+	struct list_elem *e;
+
+	for (e = list_begin (&rings); e != list_end (&rings); e = list_next (e)) {
+		struct io_ring *ring = list_entry (e, struct io_ring, elem);
+		if (ring->pml4 == pml4)
+			return ring;
+	}
+	return NULL;
+}
+
+/* Returns the number of completions in RING that the process has
+   not taken yet. */
+static uint32_t
+cq_pending (struct io_ring *ring) {
+	uint32_t n = ring->cq_tail
+		- __atomic_load_n (&ring->rings->cq_head, __ATOMIC_ACQUIRE);
+	return n <= ring->entries ? n : ring->entries;
+}
+
+/* Sets up REQ's kernel copies of its user data, in the requesting
+   process.  Returns true if successful, false if the user memory
+   is bad or memory is not available. */
+static bool
+io_prepare (struct io_req *req) {
+	struct io_sqe *sqe = &req->sqe;
+
+	switch (sqe->opcode) {
+		case IO_OPEN:
+			req->buf = malloc (IO_PATH_MAX);
+			return req->buf != NULL
+				&& copy_in_string (req->buf, (const char *) sqe->addr,
+						IO_PATH_MAX);
+		case IO_READ:
+		case IO_WRITE:
+			if (sqe->len > IO_LEN_MAX)
+				sqe->len = IO_LEN_MAX;
+			req->buf = malloc (sqe->len > 0 ? sqe->len : 1);
+			if (req->buf == NULL)
+				return false;
+			if (sqe->opcode == IO_READ)
+				return user_buffer_ok ((void *) sqe->addr, sqe->len, true);
+			return copy_from_user (req->buf, (const void *) sqe->addr,
+					sqe->len);
+		default:
+			return true;
+	}
+}
+
+/* Carries out REQ_, a struct io_req, in a worker thread. */
+static void
+io_execute (void *req_) {
+	struct io_req *req = req_;
+	struct io_ring *ring = req->ring;
+	bool write = req->sqe.opcode == IO_WRITE;
+	int res = io_do (ring, req);
+
+	lock_acquire (&ring->lock);
+	if (req->sqe.opcode == IO_FSYNC && res == 0 && ring->write_cnt > 0)
+		list_push_back (&ring->fsyncs, &req->elem);
+	else if (req->sqe.opcode == IO_READ && res > 0) {
+		req->res = res;
+		list_push_back (&ring->reads, &req->elem);
+	} else
+		io_complete (ring, req, res);
+	if (write && --ring->write_cnt == 0)
+		while (!list_empty (&ring->fsyncs))
+			io_complete (ring, list_entry (list_pop_front (&ring->fsyncs),
+						struct io_req, elem), 0);
+	ring->running--;
+	cond_broadcast (&ring->idle, &ring->lock);
+	lock_release (&ring->lock);
+}
+
+/* Copies the data of RING's parked reads out to the user and
+   posts their completions.  Must run in the process that owns
+   RING, with RING's lock held. */
+static void
+deliver_reads (struct io_ring *ring) {
+	while (!list_empty (&ring->reads)) {
+		struct io_req *req = list_entry (list_pop_front (&ring->reads),
+				struct io_req, elem);
+		bool ok = copy_to_user ((void *) req->sqe.addr, req->buf, req->res);
+		io_complete (ring, req, ok ? req->res : -1);
+	}
+}
+
+/* Returns a new reference to file FD of RING, or a null pointer
+   if FD is not open. */
+static struct file *
+file_get (struct io_ring *ring, int fd) {
+	struct file *file = NULL;
+
+	if (fd < 0 || fd >= IO_FILES_MAX)
+		return NULL;
+	lock_acquire (&ring->lock);
+	lock_acquire (&fs_lock);
+	if (ring->files[fd] != NULL)
+		file = file_reopen (ring->files[fd]);
+	lock_release (&fs_lock);
+	lock_release (&ring->lock);
+	return file;
+}
+
+/* Drops a reference returned by file_get(). */
+static void
+file_put (struct file *file) {
+	lock_acquire (&fs_lock);
+	file_close (file);
+	lock_release (&fs_lock);
+}
+
+/* Opens the file named NAME on RING and returns its fd, or -1 on
+   failure. */
+static int
+io_open (struct io_ring *ring, const char *name) {
+	struct file *file;
+	int fd;
+
+	lock_acquire (&fs_lock);
+	file = filesys_open (name);
+	lock_release (&fs_lock);
+	if (file == NULL)
+		return -1;
+
+	lock_acquire (&ring->lock);
+	for (fd = 0; fd < IO_FILES_MAX; fd++)
+		if (ring->files[fd] == NULL) {
+			ring->files[fd] = file;
+			break;
+		}
+	lock_release (&ring->lock);
+	if (fd == IO_FILES_MAX) {
+		file_put (file);
+		return -1;
+	}
+	return fd;
+}
+
+/* Closes file FD of RING.  Requests still using it keep their own
+   references.  Returns 0 if successful, -1 if FD is not open. */
+static int
+io_close (struct io_ring *ring, int fd) {
+	struct file *file;
+
+	if (fd < 0 || fd >= IO_FILES_MAX)
+		return -1;
+	lock_acquire (&ring->lock);
+	file = ring->files[fd];
+	ring->files[fd] = NULL;
+	lock_release (&ring->lock);
+	if (file == NULL)
+		return -1;
+	file_put (file);
+	return 0;
+}
+
+/* Carries out REQ for RING and returns its result.  Reads and
+   writes use REQ's bounce buffer. */
+static int
+io_do (struct io_ring *ring, struct io_req *req) {
+	const struct io_sqe *sqe = &req->sqe;
+	struct file *file;
+	int res;
+
+	switch (sqe->opcode) {
+		case IO_NOP:
+			return 0;
+		case IO_OPEN:
+			return io_open (ring, req->buf);
+		case IO_CLOSE:
+			return io_close (ring, sqe->fd);
+		case IO_READ:
+		case IO_WRITE:
+			file = file_get (ring, sqe->fd);
+			if (file == NULL)
+				return -1;
+			if (sqe->opcode == IO_READ)
+				res = file_read_at (file, req->buf, sqe->len, sqe->off);
+			else
+				res = file_write_at (file, req->buf, sqe->len, sqe->off);
+			file_put (file);
+			return res;
+		case IO_FSYNC:
+			file = file_get (ring, sqe->fd);
+			if (file == NULL)
+				return -1;
+			file_put (file);
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+/* Posts REQ's result RES on RING's completion ring and frees REQ.
+   RING's lock must be held. */
+static void
+io_complete (struct io_ring *ring, struct io_req *req, int res) {
+	struct io_cqe *cqe;
+
+	cqe = &ring->rings->cqes[ring->cq_tail & (ring->entries - 1)];
+
+	cqe->user_data = req->sqe.user_data;
+	cqe->res = res;
+	cqe->flags = 0;
+	ring->cq_tail++;
+	__atomic_store_n (&ring->rings->cq_tail, ring->cq_tail, __ATOMIC_RELEASE);
+
+	ring->inflight--;
+	cond_broadcast (&ring->idle, &ring->lock);
+	io_free (req);
+}
+
+/* Frees REQ and its buffer. */
+static void
+io_free (struct io_req *req) {
+	free (req->buf);
+	free (req);
+}
@@ -2,6 +2,7 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "intrinsic.h"
@@ -146,6 +147,15 @@ page_fault (struct intr_frame *f) {
 		return;
 #endif
 
+	/* A fault in copy_from_user() or copy_to_user() means the
+	   user buffer went away under it.  Make the access fail. */
+	if (!user && (f->rip == (uintptr_t) get_user_load
+				|| f->rip == (uintptr_t) put_user_store)) {
+		f->rip = f->R.rax;
+		f->R.rax = -1;
+		return;
+	}
+
 	/* Count page faults. */
 	page_fault_cnt++;
 
@@ -0,0 +1,161 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdint.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+
+/* Fast user-space mutexes.
+
+   A futex is an int in user memory.  User code takes and
+   releases locks built on it with atomic instructions alone, and
+   asks the kernel for help only to sleep while the lock is taken
+   (futex_wait()) or to wake sleepers when it lets go
+   (futex_wake()).
+
+   Each futex with sleepers has a wait queue, found in a hash
+   table by the address space and user address of the futex.
+   The wait queue is a condition variable under futex_lock, so
+   sleepers wake in priority order and futex_lock takes part in
+   priority donation like any other lock.  Checking the futex's
+   value and going to sleep both happen under futex_lock, and
+   futex_wake() takes it too, so a wakeup that follows a change
+   of the value cannot slip in between the check and the sleep.
+   A process that is exiting wakes all of its sleepers with
+   futex_wake_all(), and its threads no longer go to sleep. */
+
+/* Wait queue for one futex. */
+struct futex {
+	struct hash_elem elem;      /* futexes element. */
+	uint64_t *pml4;             /* Address space. */
+	int *uaddr;                 /* User address. */
+	struct condition waiters;   /* Sleeping threads. */
+	int waiter_cnt;             /* Number of sleeping threads. */
+};
+
+static struct lock futex_lock;  /* Protects the fields below. */
+static struct hash futexes;     /* Futexes with waiters. */
+
+static hash_hash_func futex_hash;
+static hash_less_func futex_less;
+static struct futex *futex_find (int *uaddr);
+
+/* Initializes the futex table. */
+void
+futex_init (void) {
+	lock_init (&futex_lock);
+	if (!hash_init (&futexes, futex_hash, futex_less, NULL))
+		PANIC ("futex_init: out of memory");
+}
+
+/* Sleeps until woken by futex_wake() on UADDR, provided that the
+   int at UADDR still holds EXPECTED.  Returns 0 after sleeping,
+   or -1 without sleeping if the value differs or cannot be read,
+   the process is exiting, or memory is not available.  UADDR
+   must be aligned.  The value is read with copy_from_user(),
+   because another thread may unmap it at any time. */
+int
+futex_wait (int *uaddr, int expected) {
+	struct futex *f;
+	int value;
+
+	ASSERT ((uintptr_t) uaddr % sizeof *uaddr == 0);
+
+	lock_acquire (&futex_lock);
+	if (!copy_from_user (&value, uaddr, sizeof value) || value != expected
+			|| process_exiting ()) {
+		lock_release (&futex_lock);
+		return -1;
+	}
+
+	f = futex_find (uaddr);
+	if (f == NULL) {
+		f = malloc (sizeof *f);
+		if (f == NULL) {
+			lock_release (&futex_lock);
+			return -1;
+		}
+		f->pml4 = thread_current ()->pml4;
+		f->uaddr = uaddr;
+		cond_init (&f->waiters);
+		f->waiter_cnt = 0;
+		hash_insert (&futexes, &f->elem);
+	}
+
+	f->waiter_cnt++;
+	cond_wait (&f->waiters, &futex_lock);
+	if (--f->waiter_cnt == 0) {
+		hash_delete (&futexes, &f->elem);
+		free (f);
+	}
+	lock_release (&futex_lock);
+	return 0;
+}
+
+/* Wakes up to CNT threads sleeping on UADDR, highest priority
+   first.  Returns the number of threads woken. */
+int
+futex_wake (int *uaddr, int cnt) {
+	struct futex *f;
+	int woken = 0;
+
+	lock_acquire (&futex_lock);
+	f = futex_find (uaddr);
+	if (f != NULL)
+		for (; woken < cnt && !list_empty (&f->waiters.waiters); woken++)
+			cond_signal (&f->waiters, &futex_lock);
+	lock_release (&futex_lock);
+	return woken;
+}
+
+/* Wakes every thread sleeping on a futex in the address space
+   whose page table is PML4. */
+void
+futex_wake_all (uint64_t *pml4) {
+	struct hash_iterator i;
+
+	lock_acquire (&futex_lock);
+	hash_first (&i, &futexes);
+	while (hash_next (&i)) {
+		struct futex *f = hash_entry (hash_cur (&i), struct futex, elem);
+		if (f->pml4 == pml4)
+			cond_broadcast (&f->waiters, &futex_lock);
+	}
+	lock_release (&futex_lock);
+}
+
+/* Returns the running process's futex for UADDR, or a null
+   pointer if nothing sleeps on it.  futex_lock must be held. */
+static struct futex *
+futex_find (int *uaddr) {
+	struct futex key;
+	struct hash_elem *e;
+
+	key.pml4 = thread_current ()->pml4;
+	key.uaddr = uaddr;
+	e = hash_find (&futexes, &key.elem);
+	return e != NULL ? hash_entry (e, struct futex, elem) : NULL;
+}
+
+/* Returns a hash value for futex E. */
+static uint64_t
+futex_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct futex *f = hash_entry (e, struct futex, elem);
+	return hash_bytes (&f->pml4, sizeof f->pml4)
+		^ hash_bytes (&f->uaddr, sizeof f->uaddr);
+}
+
+/* Returns true if futex A precedes futex B. */
+static bool
+futex_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct futex *a = hash_entry (a_, struct futex, elem);
+	const struct futex *b = hash_entry (b_, struct futex, elem);
+
+	if (a->pml4 != b->pml4)
+		return a->pml4 < b->pml4;
+	return a->uaddr < b->uaddr;
+}
@@ -0,0 +1,324 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "userprog/shm.h"
+#include "userprog/syscall.h"
+
+/* Pipes.
+
+   A pipe holds its data in a ring of up to PIPE_PAGES pages.
+   Each page in the ring holds a run of bytes, which writers
+   append to the last page and readers consume from the first.
+   A page is freed as soon as it has been read to the end.
+
+   Ordinary reads and writes copy bytes between the ring and the
+   user's buffer with copy_to_user() and copy_from_user(), because
+   another thread of the process may unmap the buffer while this
+   one waits on the pipe.  Flipping reads and writes, used by
+   vmsplice(), move whole pages instead wherever the user's buffer
+   covers a page-aligned page.  The writer's page goes into the ring as is,
+   and the writer gets a zeroed page in its place.  A reader's page
+   is swapped out for a full page from the ring.  Each page so
+   moved saves a copy at each end.  Flipping edits the user's page
+   table directly, so it works only without VM, where the page
+   table is the whole story; with VM, flipping falls back to
+   copying.  Pages of shared memory segments are always copied,
+   because their frames belong to the segment, not to the
+   process.
+
+   A transfer stops short at the first byte of the buffer that is
+   not mapped. */
+
+/* Maximum pages in a pipe. */
+#define PIPE_PAGES 16
+
+/* A page in a pipe's ring. */
+struct pipe_page {
+	uint8_t *kpage;             /* Kernel virtual address of the page. */
+	size_t ofs;                 /* Offset of the first unread byte. */
+	size_t len;                 /* Number of unread bytes. */
+};
+
+/* A pipe. */
+struct pipe {
+	struct lock lock;           /* Protects the fields below. */
+	struct condition readable;  /* Signalled when data arrives or
+	                               the last writer goes. */
+	struct condition writable;  /* Signalled when room frees up or
+	                               the last reader goes. */
+	struct pipe_page ring[PIPE_PAGES]; /* Pages holding data. */
+	size_t head;                /* Index of the first page in ring. */
+	size_t page_cnt;            /* Number of pages in ring. */
+	int readers;                /* Number of open read ends. */
+	int writers;                /* Number of open write ends. */
+};
+
+static bool flip_in (struct pipe *, uint8_t *upage);
+static bool flip_out (struct pipe *, uint8_t *upage);
+static void free_pipe (struct pipe *);
+
+/* Creates and returns a pipe with one read end and one write end
+   open, or a null pointer if memory is not available. */
+struct pipe *
+pipe_create (void) {
+	struct pipe *p = malloc (sizeof *p);
+
+	if (p != NULL) {
+		lock_init (&p->lock);
+		cond_init (&p->readable);
+		cond_init (&p->writable);
+		p->head = 0;
+		p->page_cnt = 0;
+		p->readers = 1;
+		p->writers = 1;
+	}
+	return p;
+}
+
+/* Opens another read end of P, or another write end if WRITER. */
+void
+pipe_open (struct pipe *p, bool writer) {
+	lock_acquire (&p->lock);
+	if (writer)
+		p->writers++;
+	else
+		p->readers++;
+	lock_release (&p->lock);
+}
+
+/* Closes a read end of P, or a write end if WRITER, and frees P
+   once no end is open. */
+void
+pipe_close (struct pipe *p, bool writer) {
+	bool last;
+
+	lock_acquire (&p->lock);
+	if (writer) {
+		ASSERT (p->writers > 0);
+		if (--p->writers == 0)
+			cond_broadcast (&p->readable, &p->lock);
+	} else {
+		ASSERT (p->readers > 0);
+		if (--p->readers == 0)
+			cond_broadcast (&p->writable, &p->lock);
+	}
+	last = p->readers == 0 && p->writers == 0;
+	lock_release (&p->lock);
+
+	if (last)
+		free_pipe (p);
+}
+
+/* Returns the I'th page of P's ring, counting from the first. */
+static struct pipe_page *
+ring_page (struct pipe *p, size_t i) {
+	return &p->ring[(p->head + i) % PIPE_PAGES];
+}
+
+/* Reads up to SIZE bytes from P into user BUFFER.  Waits for data
+   if P is empty, unless NONBLOCK.  If FLIP, moves whole pages
+   where it can.  Returns the number of bytes read, 0 at end of
+   file once every write end is closed, or -1 if P is empty and
+   NONBLOCK or the process is exiting, or if BUFFER is not mapped
+   before any byte is read. */
+int
+pipe_read (struct pipe *p, void *buffer, size_t size, bool nonblock,
+		bool flip) {
+	uint8_t *dst = buffer;
+	size_t done = 0;
+
+	lock_acquire (&p->lock);
+	while (p->page_cnt == 0 && size > 0) {
+		if (p->writers == 0 || nonblock || process_exiting ()) {
+			int result = p->writers == 0 && !process_exiting () ? 0 : -1;
+			lock_release (&p->lock);
+			return result;
+		}
+		cond_wait (&p->readable, &p->lock);
+	}
+
+	while (done < size && p->page_cnt > 0) {
+		struct pipe_page *pp = ring_page (p, 0);
+		size_t n;
+
+		if (flip && size - done >= PGSIZE && pg_ofs (dst + done) == 0
+				&& flip_out (p, dst + done)) {
+			done += PGSIZE;
+			continue;
+		}
+
+		n = pp->len < size - done ? pp->len : size - done;
+		if (!copy_to_user (dst + done, pp->kpage + pp->ofs, n))
+			break;
+		pp->ofs += n;
+		pp->len -= n;
+		done += n;
+
+		if (pp->len == 0) {
+			palloc_free_page (pp->kpage);
+			p->head = (p->head + 1) % PIPE_PAGES;
+			p->page_cnt--;
+		}
+	}
+	cond_broadcast (&p->writable, &p->lock);
+	lock_release (&p->lock);
+	return done > 0 || size == 0 ? (int) done : -1;
+}
+
+/* Writes the SIZE bytes in user BUFFER to P, waiting for room as
+   necessary, unless NONBLOCK.  If FLIP, moves whole pages where
+   it can, leaving zeros in their place in BUFFER.  Returns the
+   number of bytes written, which is less than SIZE only if
+   NONBLOCK, memory ran out, the process is exiting, or BUFFER is
+   not mapped, or -1 if nothing at all is written. */
+int
+pipe_write (struct pipe *p, void *buffer, size_t size, bool nonblock,
+		bool flip) {
+	uint8_t *src = buffer;
+	size_t done = 0;
+
+	lock_acquire (&p->lock);
+	while (done < size) {
+		struct pipe_page *tail = p->page_cnt > 0
+			? ring_page (p, p->page_cnt - 1) : NULL;
+		size_t room = tail != NULL ? PGSIZE - tail->ofs - tail->len : 0;
+		size_t n;
+
+		if (p->readers == 0 || process_exiting ())
+			break;
+
+		if (flip && size - done >= PGSIZE && pg_ofs (src + done) == 0
+				&& p->page_cnt < PIPE_PAGES && flip_in (p, src + done)) {
+			done += PGSIZE;
+			cond_broadcast (&p->readable, &p->lock);
+			continue;
+		}
+
+		if (room == 0) {
+			if (p->page_cnt < PIPE_PAGES) {
+				uint8_t *kpage = palloc_get_page (PAL_USER);
+				if (kpage == NULL)
+					break;
+				tail = ring_page (p, p->page_cnt++);
+				tail->kpage = kpage;
+				tail->ofs = tail->len = 0;
+				room = PGSIZE;
+			} else if (nonblock)
+				break;
+			else {
+				cond_wait (&p->writable, &p->lock);
+				continue;
+			}
+		}
+
+		n = room < size - done ? room : size - done;
+		if (!copy_from_user (tail->kpage + tail->ofs + tail->len,
+					src + done, n))
+			break;
+		tail->len += n;
+		done += n;
+		cond_broadcast (&p->readable, &p->lock);
+	}
+	lock_release (&p->lock);
+	return done > 0 || size == 0 ? (int) done : -1;
+}
+
+#ifndef VM
+/* Moves the running process's page at UPAGE to the end of P's
+   ring, mapping a zeroed page at UPAGE in its place.  Returns
+   true if successful, false if the page cannot be moved.  P's
+   ring must not be full. */
+static bool
+flip_in (struct pipe *p, uint8_t *upage) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 0);
+	struct pipe_page *pp;
+	void *kpage, *zpage;
+
+	if (pte == NULL || !(*pte & PTE_P) || !is_writable (pte)
+			|| shm_mapped (pml4, upage))
+		return false;
+	zpage = palloc_get_page (PAL_USER | PAL_ZERO);
+	if (zpage == NULL)
+		return false;
+
+	kpage = pml4_get_page (pml4, upage);
+	pml4_clear_page (pml4, upage);
+	if (!pml4_set_page (pml4, upage, zpage, true)) {
+		pml4_set_page (pml4, upage, kpage, true);
+		palloc_free_page (zpage);
+		return false;
+	}
+
+	pp = ring_page (p, p->page_cnt++);
+	pp->kpage = kpage;
+	pp->ofs = 0;
+	pp->len = PGSIZE;
+	return true;
+}
+
+/* Moves the full page at the head of P's ring to UPAGE in the
+   running process, freeing the page that was there.  Returns
+   true if successful, false if the head of the ring is not a
+   full page. */
+static bool
+flip_out (struct pipe *p, uint8_t *upage) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	struct pipe_page *pp = ring_page (p, 0);
+	void *old;
+
+	if (pp->ofs != 0 || pp->len != PGSIZE || shm_mapped (pml4, upage))
+		return false;
+
+	old = pml4_get_page (pml4, upage);
+	pml4_clear_page (pml4, upage);
+	if (!pml4_set_page (pml4, upage, pp->kpage, true)) {
+		pml4_set_page (pml4, upage, old, true);
+		return false;
+	}
+	palloc_free_page (old);
+
+	p->head = (p->head + 1) % PIPE_PAGES;
+	p->page_cnt--;
+	return true;
+}
+#else
+/* Page flipping needs the supplemental page table's cooperation,
+   so with VM every transfer is a copy. */
+static bool
+flip_in (struct pipe *p UNUSED, uint8_t *upage UNUSED) {
+	return false;
+}
+
+static bool
+flip_out (struct pipe *p UNUSED, uint8_t *upage UNUSED) {
+	return false;
+}
+#endif
+
+/* Wakes every thread waiting on P, so that threads of an exiting
+   process notice and give up. */
+void
+pipe_wake (struct pipe *p) {
+	lock_acquire (&p->lock);
+	cond_broadcast (&p->readable, &p->lock);
+	cond_broadcast (&p->writable, &p->lock);
+	lock_release (&p->lock);
+}
+
+/* Frees P and the pages in its ring. */
+static void
+free_pipe (struct pipe *p) {
+	while (p->page_cnt > 0) {
+		palloc_free_page (ring_page (p, 0)->kpage);
+		p->head = (p->head + 1) % PIPE_PAGES;
+		p->page_cnt--;
+	}
+	free (p);
+}
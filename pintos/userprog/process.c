@@ -5,7 +5,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/aio.h"
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
+#include "userprog/pipe.h"
+#include "userprog/shm.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -13,7 +17,9 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
@@ -26,6 +32,40 @@ static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static bool heap_map (void *upage);
+static void heap_unmap (void *upage);
+static struct thread_group *group_create (struct thread *leader);
+static void group_exit (void);
+static void member_exit (void);
+static void dup_pipes (struct thread_group *, struct thread_group *);
+static void wake_pipes (struct thread_group *);
+
+/* The threads of one user process.  The group's first thread,
+ * its leader, owns the address space: the page tables, the
+ * supplemental page table, and the heap.  Threads added with
+ * process_spawn() share it.  The leader outlives the rest of the
+ * group, so they never see the address space torn down. */
+struct thread_group {
+	struct thread *leader;      /* Owner of the address space. */
+	uint8_t *heap_start;        /* Bottom of the heap, above the loaded image. */
+	uint8_t *heap_brk;          /* Program break, the top of the heap. */
+	struct lock lock;           /* Protects the fields below, and the heap. */
+	struct condition changed;   /* Signalled when a thread exits. */
+	struct list members;        /* Spawned threads not yet joined. */
+	int live_cnt;               /* Running threads, leader included. */
+	bool exiting;               /* Is the whole process exiting? */
+	struct pipe_fd pipes[PIPE_FD_CNT]; /* Pipe ends, indexed by fd. */
+};
+
+/* Join record for a thread added with process_spawn(). */
+struct group_member {
+	struct list_elem elem;      /* thread_group's members element. */
+	tid_t tid;                  /* Thread identifier. */
+	int status;                 /* Exit status. */
+	bool voluntary;             /* Ended by process_thread_exit()? */
+	bool exited;                /* Has the thread exited? */
+	bool joining;               /* Is a thread waiting to join it? */
+};
 
 /* General process initializer for initd and other process. */
 static void
@@ -88,11 +128,15 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 	struct thread *current = thread_current ();
 	struct thread *parent = (struct thread *) aux;
 	void *parent_page;
-	void *newpage;
-	bool writable;
+	void *newpage = NULL;
+	bool writable = false;
 
 	/* 1. TODO: If the parent_page is kernel page, then return immediately. */
 
+	/* Shared memory is mapped by shm_fork(), not copied. */
+	if (shm_mapped (parent->pml4, va))
+		return true;
+
 	/* 2. Resolve VA from the parent's page map level 4. */
 	parent_page = pml4_get_page (parent->pml4, va);
 
@@ -134,14 +178,25 @@ __do_fork (void *aux) {
 		goto error;
 
 	process_activate (current);
+	current->group = group_create (current);
+	if (current->group == NULL)
+		goto error;
+	current->group->heap_start = parent->group->heap_start;
+	current->group->heap_brk = parent->group->heap_brk;
+	dup_pipes (current->group, parent->group);
 #ifdef VM
 	supplemental_page_table_init (&current->spt);
-	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
+	/* A spawned thread's own table is unused; the leader's holds
+	 * the process's pages. */
+	if (!supplemental_page_table_copy (&current->spt,
+				&parent->group->leader->spt))
 		goto error;
 #else
 	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
 		goto error;
 #endif
+	if (!shm_fork (current->pml4, parent->pml4))
+		goto error;
 
 	/* TODO: Your code goes here.
 	 * TODO: Hint) To duplicate the file object, use `file_duplicate`
@@ -162,9 +217,19 @@ error:
  * Returns -1 on fail. */
 int
 process_exec (void *f_name) {
+	struct thread *t = thread_current ();
 	char *file_name = f_name;
 	bool success;
 
+	/* Other threads would lose their address space under them, so
+	 * only a lone thread may exec. */
+	if (t->group == NULL)
+		t->group = group_create (t);
+	if (t->group == NULL || t->group->live_cnt > 1 || t->member != NULL) {
+		palloc_free_page (file_name);
+		return -1;
+	}
+
 	/* We cannot use the intr_frame in the thread structure.
 	 * This is because when current thread rescheduled,
 	 * it stores the execution information to the member. */
@@ -216,6 +281,13 @@ process_exit (void) {
 	 * TODO: project2/process_termination.html).
 	 * TODO: We recommend you to implement process resource cleanup here. */
 
+	if (curr->member != NULL) {
+		/* The leader cleans up the shared address space. */
+		member_exit ();
+		return;
+	}
+	if (curr->group != NULL)
+		group_exit ();
 	process_cleanup ();
 }
 
@@ -242,6 +314,8 @@ process_cleanup (void) {
 		 * that's been freed (and cleared). */
 		curr->pml4 = NULL;
 		pml4_activate (NULL);
+		aio_cleanup (pml4);
+		shm_unmap_all (pml4);
 		pml4_destroy (pml4);
 	}
 }
@@ -257,6 +331,395 @@ process_activate (struct thread *next) {
 	tss_update (next);
 }
 
+/* Highest address the program break may reach, leaving room below
+ * USER_STACK for the stack to grow. */
+#define HEAP_LIMIT ((uint8_t *) USER_STACK - (8 << 20))
+
+/* Moves the running process's program break by INCREMENT bytes
+ * and returns the old break, or (void *) -1 if the break would
+ * leave the range between the loaded image and HEAP_LIMIT or
+ * memory ran out.  Pages the heap grows into read as zeros;
+ * pages it shrinks out of are unmapped. */
+void *
+process_sbrk (intptr_t increment) {
+	struct thread_group *g = thread_current ()->group;
+	uint8_t *old_brk, *new_brk, *old_top, *new_top, *page;
+
+	if (g == NULL)
+		return (void *) -1;
+
+	lock_acquire (&g->lock);
+	old_brk = g->heap_brk;
+	if (increment >= 0
+			? (uintptr_t) increment > (uintptr_t) (HEAP_LIMIT - old_brk)
+			: 0 - (uintptr_t) increment > (uintptr_t) (old_brk - g->heap_start)) {
+		lock_release (&g->lock);
+		return (void *) -1;
+	}
+
+	new_brk = old_brk + increment;
+	old_top = pg_round_up (old_brk);
+	new_top = pg_round_up (new_brk);
+
+	for (page = old_top; page < new_top; page += PGSIZE)
+		if (!heap_map (page)) {
+			while (page > old_top)
+				heap_unmap (page -= PGSIZE);
+			lock_release (&g->lock);
+			return (void *) -1;
+		}
+	for (page = new_top; page < old_top; page += PGSIZE)
+		heap_unmap (page);
+
+	g->heap_brk = new_brk;
+	lock_release (&g->lock);
+	return old_brk;
+}
+
+/* Creates a thread group led by LEADER, with an empty heap.
+ * Returns a null pointer if memory is not available. */
+static struct thread_group *
+group_create (struct thread *leader) {
+	struct thread_group *g = malloc (sizeof *g);
+
+	if (g != NULL) {
+		g->leader = leader;
+		g->heap_start = g->heap_brk = NULL;
+		lock_init (&g->lock);
+		cond_init (&g->changed);
+		list_init (&g->members);
+		g->live_cnt = 1;
+		g->exiting = false;
+		memset (g->pipes, 0, sizeof g->pipes);
+	}
+	return g;
+}
+
+/* Arguments for spawn_start(). */
+struct spawn_aux {
+	struct thread_group *group; /* Group to join. */
+	struct group_member *member; /* Join record. */
+	struct intr_frame if_;      /* User context to start in. */
+};
+
+/* A thread function that enters user mode in a spawned thread. */
+static void
+spawn_start (void *aux_) {
+	struct spawn_aux *aux = aux_;
+	struct thread *t = thread_current ();
+	struct intr_frame if_ = aux->if_;
+
+	t->group = aux->group;
+	t->member = aux->member;
+	t->pml4 = t->group->leader->pml4;
+	free (aux);
+
+	process_activate (t);
+	if (process_exiting ())
+		thread_exit ();
+	do_iret (&if_);
+	NOT_REACHED ();
+}
+
+/* Starts a thread in the running process that calls ENTRY with
+ * ARG in user mode, on the stack whose top is STACK.  The thread
+ * shares the process's address space and heap.  Returns the new
+ * thread's identifier, or TID_ERROR if the thread cannot be
+ * created. */
+tid_t
+process_spawn (void *entry, void *stack, void *arg) {
+	struct thread *t = thread_current ();
+	struct thread_group *g = t->group;
+	struct group_member *m;
+	struct spawn_aux *aux;
+	tid_t tid;
+
+	if (g == NULL || !is_user_vaddr (entry) || !is_user_vaddr (stack))
+		return TID_ERROR;
+
+	m = malloc (sizeof *m);
+	aux = malloc (sizeof *aux);
+	if (m == NULL || aux == NULL) {
+		free (m);
+		free (aux);
+		return TID_ERROR;
+	}
+	m->tid = TID_ERROR;
+	m->status = -1;
+	m->voluntary = m->exited = m->joining = false;
+
+	/* Start at ENTRY (ARG), as if called with STACK 16-byte
+	 * aligned. */
+	memset (&aux->if_, 0, sizeof aux->if_);
+	aux->if_.rip = (uintptr_t) entry;
+	aux->if_.rsp = ((uintptr_t) stack & ~(uintptr_t) 0xf) - sizeof (void *);
+	aux->if_.R.rdi = (uint64_t) arg;
+	aux->if_.ds = aux->if_.es = aux->if_.ss = SEL_UDSEG;
+	aux->if_.cs = SEL_UCSEG;
+	aux->if_.eflags = FLAG_IF | FLAG_MBS;
+	aux->group = g;
+	aux->member = m;
+
+	lock_acquire (&g->lock);
+	if (g->exiting) {
+		lock_release (&g->lock);
+		free (m);
+		free (aux);
+		return TID_ERROR;
+	}
+	list_push_back (&g->members, &m->elem);
+	g->live_cnt++;
+	lock_release (&g->lock);
+
+	tid = thread_create (t->name, thread_get_priority (), spawn_start, aux);
+
+	lock_acquire (&g->lock);
+	if (tid == TID_ERROR) {
+		list_remove (&m->elem);
+		g->live_cnt--;
+		free (m);
+		free (aux);
+	} else
+		m->tid = tid;
+	lock_release (&g->lock);
+	return tid;
+}
+
+/* Waits for thread TID of the running process, started by
+ * process_spawn(), to exit and returns the status it passed to
+ * process_thread_exit().  Returns -1 at once if TID is not such a
+ * thread, has already been joined, or another thread is joining
+ * it, and -1 if the process exits meanwhile. */
+int
+process_join (tid_t tid) {
+	struct thread_group *g = thread_current ()->group;
+	struct group_member *m = NULL;
+	struct list_elem *e;
+	int status = -1;
+
+	if (g == NULL)
+		return -1;
+
+	lock_acquire (&g->lock);
+	for (e = list_begin (&g->members); e != list_end (&g->members);
+			e = list_next (e))
+		if (list_entry (e, struct group_member, elem)->tid == tid) {
+			m = list_entry (e, struct group_member, elem);
+			break;
+		}
+	if (m != NULL && !m->joining && m != thread_current ()->member) {
+		m->joining = true;
+		while (!m->exited && !g->exiting)
+			cond_wait (&g->changed, &g->lock);
+		if (m->exited) {
+			status = m->status;
+			list_remove (&m->elem);
+			free (m);
+		} else
+			m->joining = false;
+	}
+	lock_release (&g->lock);
+	return status;
+}
+
+/* Ends the running thread with STATUS, for process_join() to
+ * collect.  In the leader, ends the whole process instead. */
+void
+process_thread_exit (int status) {
+	struct group_member *m = thread_current ()->member;
+
+	if (m != NULL) {
+		m->status = status;
+		m->voluntary = true;
+	}
+	thread_exit ();
+}
+
+/* Returns true if the running thread's process is exiting, in
+ * which case the thread should exit as soon as it can. */
+bool
+process_exiting (void) {
+	struct thread_group *g = thread_current ()->group;
+	return g != NULL && g->exiting;
+}
+
+/* Ends the process's other threads and frees the running
+ * leader's thread group.  Threads blocked in the kernel are woken
+ * up; each exits on its next system call or interrupt. */
+static void
+group_exit (void) {
+	struct thread *t = thread_current ();
+	struct thread_group *g = t->group;
+	int fd;
+
+	lock_acquire (&g->lock);
+	g->exiting = true;
+	lock_release (&g->lock);
+	futex_wake_all (t->pml4);
+	wake_pipes (g);
+
+	lock_acquire (&g->lock);
+	cond_broadcast (&g->changed, &g->lock);
+	while (g->live_cnt > 1)
+		cond_wait (&g->changed, &g->lock);
+	lock_release (&g->lock);
+
+	while (!list_empty (&g->members))
+		free (list_entry (list_pop_front (&g->members),
+					struct group_member, elem));
+	for (fd = 0; fd < PIPE_FD_CNT; fd++)
+		if (g->pipes[fd].pipe != NULL)
+			pipe_close (g->pipes[fd].pipe, g->pipes[fd].writer);
+	free (g);
+	t->group = NULL;
+}
+
+/* Ends a spawned thread.  Unless it called process_thread_exit(),
+ * the thread died of a fault or called exit(), which ends the
+ * whole process. */
+static void
+member_exit (void) {
+	struct thread *t = thread_current ();
+	struct thread_group *g = t->group;
+	struct group_member *m = t->member;
+
+	if (!m->voluntary) {
+		lock_acquire (&g->lock);
+		g->exiting = true;
+		lock_release (&g->lock);
+		futex_wake_all (t->pml4);
+		wake_pipes (g);
+	}
+
+	lock_acquire (&g->lock);
+	m->exited = true;
+	g->live_cnt--;
+	cond_broadcast (&g->changed, &g->lock);
+	lock_release (&g->lock);
+
+	/* The address space belongs to the leader, which may free it
+	 * as soon as the count above drops. */
+	t->pml4 = NULL;
+	pml4_activate (NULL);
+	t->group = NULL;
+	t->member = NULL;
+}
+
+/* Creates a pipe and stores descriptors for its read and write
+ * ends in FDS[0] and FDS[1].  The ends fail instead of blocking
+ * if NONBLOCK.  Returns 0 if successful, -1 if the running
+ * process is out of descriptors or memory is not available. */
+int
+process_pipe (int fds[2], bool nonblock) {
+	struct thread_group *g = thread_current ()->group;
+	struct pipe *p;
+	int rfd, wfd;
+
+	if (g == NULL)
+		return -1;
+
+	lock_acquire (&g->lock);
+	for (rfd = PIPE_FD_MIN; rfd < PIPE_FD_CNT; rfd++)
+		if (g->pipes[rfd].pipe == NULL)
+			break;
+	for (wfd = rfd + 1; wfd < PIPE_FD_CNT; wfd++)
+		if (g->pipes[wfd].pipe == NULL)
+			break;
+	p = wfd < PIPE_FD_CNT ? pipe_create () : NULL;
+	if (p == NULL) {
+		lock_release (&g->lock);
+		return -1;
+	}
+	g->pipes[rfd] = (struct pipe_fd) { p, false, nonblock };
+	g->pipes[wfd] = (struct pipe_fd) { p, true, nonblock };
+	lock_release (&g->lock);
+
+	fds[0] = rfd;
+	fds[1] = wfd;
+	return 0;
+}
+
+/* If FD is a pipe end in the running process, copies it into
+ * *PFD, opening another reference to the end that the caller must
+ * drop with pipe_close(), and returns true.  Otherwise returns
+ * false.  The reference keeps the pipe alive if another thread
+ * closes FD meanwhile. */
+bool
+process_get_pipe (int fd, struct pipe_fd *pfd) {
+	struct thread_group *g = thread_current ()->group;
+	bool found;
+
+	if (g == NULL || fd < PIPE_FD_MIN || fd >= PIPE_FD_CNT)
+		return false;
+
+	lock_acquire (&g->lock);
+	*pfd = g->pipes[fd];
+	found = pfd->pipe != NULL;
+	if (found)
+		pipe_open (pfd->pipe, pfd->writer);
+	lock_release (&g->lock);
+	return found;
+}
+
+/* Closes FD and returns true if it is a pipe end in the running
+ * process, otherwise returns false. */
+bool
+process_close_pipe (int fd) {
+	struct thread_group *g = thread_current ()->group;
+	struct pipe_fd pfd;
+
+	if (g == NULL || fd < PIPE_FD_MIN || fd >= PIPE_FD_CNT)
+		return false;
+
+	lock_acquire (&g->lock);
+	pfd = g->pipes[fd];
+	g->pipes[fd].pipe = NULL;
+	lock_release (&g->lock);
+
+	if (pfd.pipe == NULL)
+		return false;
+	pipe_close (pfd.pipe, pfd.writer);
+	return true;
+}
+
+/* Gives NEW, a forked child's group, its own references to the
+ * pipe ends open in PARENT. */
+static void
+dup_pipes (struct thread_group *new, struct thread_group *parent) {
+	int fd;
+
+	lock_acquire (&parent->lock);
+	for (fd = 0; fd < PIPE_FD_CNT; fd++) {
+		new->pipes[fd] = parent->pipes[fd];
+		if (new->pipes[fd].pipe != NULL)
+			pipe_open (new->pipes[fd].pipe, new->pipes[fd].writer);
+	}
+	lock_release (&parent->lock);
+}
+
+/* Wakes the threads waiting on the pipes open in G, which is
+ * exiting, so that they give up. */
+static void
+wake_pipes (struct thread_group *g) {
+	int fd;
+
+	lock_acquire (&g->lock);
+	for (fd = 0; fd < PIPE_FD_CNT; fd++)
+		if (g->pipes[fd].pipe != NULL)
+			pipe_wake (g->pipes[fd].pipe);
+	lock_release (&g->lock);
+}
+
+#ifdef VM
+/* Returns the running process's supplemental page table, which
+ * its threads share. */
+struct supplemental_page_table *
+process_spt (void) {
+	struct thread *t = thread_current ();
+	return t->group != NULL ? &t->group->leader->spt : &t->spt;
+}
+#endif
+
 /* We load ELF binaries.  The following definitions are taken
  * from the ELF specification, [ELF1], more-or-less verbatim.  */
 
@@ -326,6 +789,7 @@ load (const char *file_name, struct intr_frame *if_) {
 	struct ELF ehdr;
 	struct file *file = NULL;
 	off_t file_ofs;
+	uint64_t image_end = 0;
 	bool success = false;
 	int i;
 
@@ -400,6 +864,8 @@ load (const char *file_name, struct intr_frame *if_) {
 					if (!load_segment (file, file_page, (void *) mem_page,
 								read_bytes, zero_bytes, writable))
 						goto done;
+					if (mem_page + read_bytes + zero_bytes > image_end)
+						image_end = mem_page + read_bytes + zero_bytes;
 				}
 				else
 					goto done;
@@ -407,6 +873,9 @@ load (const char *file_name, struct intr_frame *if_) {
 		}
 	}
 
+	/* The heap starts empty, just above the loaded image. */
+	t->group->heap_start = t->group->heap_brk = (uint8_t *) image_end;
+
 	/* Set up stack. */
 	if (!setup_stack (if_))
 		goto done;
@@ -569,6 +1038,29 @@ install_page (void *upage, void *kpage, bool writable) {
 	return (pml4_get_page (t->pml4, upage) == NULL
 			&& pml4_set_page (t->pml4, upage, kpage, writable));
 }
+
+/* Backs heap page UPAGE with a zeroed page right away.  Returns
+ * true on success. */
+static bool
+heap_map (void *upage) {
+	uint8_t *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+
+	if (kpage != NULL && !install_page (upage, kpage, true)) {
+		palloc_free_page (kpage);
+		kpage = NULL;
+	}
+	return kpage != NULL;
+}
+
+/* Unmaps heap page UPAGE and frees the page behind it. */
+static void
+heap_unmap (void *upage) {
+	struct thread *t = thread_current ();
+	void *kpage = pml4_get_page (t->pml4, upage);
+
+	pml4_clear_page (t->pml4, upage);
+	palloc_free_page (kpage);
+}
 #else
 /* From here, codes will be used after project 3.
  * If you want to implement the function for only project 2, implement it on the
@@ -636,4 +1128,24 @@ setup_stack (struct intr_frame *if_) {
 
 	return success;
 }
+
+/* Registers heap page UPAGE as an anonymous page, to be zeroed
+ * and mapped on its first fault.  Returns true on success. */
+static bool
+heap_map (void *upage) {
+	return vm_alloc_page (VM_ANON, upage, true);
+}
+
+/* Removes heap page UPAGE from the supplemental page table,
+ * freeing its frame if it was ever faulted in. */
+static void
+heap_unmap (void *upage) {
+	struct thread *t = thread_current ();
+	struct page *page = spt_find_page (process_spt (), upage);
+
+	if (page != NULL) {
+		pml4_clear_page (t->pml4, upage);
+		spt_remove_page (process_spt (), page);
+	}
+}
 #endif /* VM */
@@ -0,0 +1,391 @@
+#include "userprog/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Shared memory segments.
+
+   A segment is a named run of zeroed pages that any process may
+   map with shm_map(), at an address of its choosing.  Every
+   process that maps a segment sees the same frames, so a write
+   by one is visible to all the others at once.
+
+   Each segment keeps the list of its mappings, each one an
+   address space and a user address.  This reverse map is how the
+   kernel finds every page table entry that points at the
+   segment's frames, to tear them down when a process exits or to
+   share them with a forked child.  The segment's frames are freed
+   together when the last mapping goes and the name has been
+   removed with shm_unlink(), so each mapping and the name each
+   hold a reference to all of the segment's frames.  So does the
+   kernel, for a segment it shares with a process through
+   shm_map_page().
+
+   The mappings live in the page table alone, so process_cleanup()
+   must take them out with shm_unmap_all() before pml4_destroy()
+   frees every frame it finds. */
+
+/* A shared memory segment. */
+struct shm {
+	struct list_elem elem;      /* segments element. */
+	char name[SHM_NAME_MAX + 1]; /* Name, or "" once unlinked. */
+	size_t page_cnt;            /* Number of pages. */
+	void **pages;               /* Kernel virtual addresses of the pages. */
+	struct list maps;           /* Mappings, the reverse map. */
+	int hold_cnt;               /* References held by the kernel. */
+};
+
+/* One mapping of a segment into an address space. */
+struct shm_map {
+	struct list_elem elem;      /* shm's maps element. */
+	struct shm *shm;            /* Segment mapped. */
+	uint64_t *pml4;             /* Address space. */
+	uint8_t *addr;              /* First user page mapped. */
+	size_t page_cnt;            /* Number of pages mapped. */
+};
+
+static struct lock shm_lock;    /* Protects the fields below. */
+static struct list segments;    /* All segments. */
+
+static struct shm *shm_find (const char *name);
+static struct shm *shm_create (const char *name, size_t page_cnt);
+static struct shm_map *map_find (uint64_t *pml4, const void *va);
+static struct shm_map *map_insert (struct shm *, uint64_t *pml4,
+		uint8_t *addr, size_t page_cnt);
+static void map_remove (struct shm_map *);
+static void shm_release (struct shm *);
+
+/* Initializes the segment table. */
+void
+shm_init (void) {
+	lock_init (&shm_lock);
+	list_init (&segments);
+}
+
+/* Maps the first SIZE bytes of the segment called NAME at ADDR in
+   the running process, creating the segment with SIZE bytes if it
+   does not exist yet.  A SIZE of 0 maps all of an existing
+   segment.  ADDR must be page-aligned and the pages it covers
+   unmapped.  Returns ADDR if successful, a null pointer on
+   failure. */
+void *
+shm_map (const char *name, void *addr, size_t size) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+	uint8_t *upage = addr;
+	struct shm *shm;
+	bool created = false;
+	size_t i;
+
+	if (pml4 == NULL || name[0] == '\0' || upage == NULL
+			|| pg_ofs (upage) != 0 || page_cnt > SHM_PAGES_MAX)
+		return NULL;
+
+	lock_acquire (&shm_lock);
+	shm = shm_find (name);
+	if (shm == NULL && page_cnt > 0) {
+		shm = shm_create (name, page_cnt);
+		created = shm != NULL;
+	}
+	if (shm == NULL || page_cnt > shm->page_cnt)
+		goto fail;
+	if (page_cnt == 0)
+		page_cnt = shm->page_cnt;
+
+	/* The pages must be free user pages. */
+	if ((uintptr_t) upage + page_cnt * PGSIZE < (uintptr_t) upage
+			|| !is_user_vaddr (upage + page_cnt * PGSIZE - 1))
+		goto fail;
+	for (i = 0; i < page_cnt; i++)
+		if (pml4_get_page (pml4, upage + i * PGSIZE) != NULL)
+			goto fail;
+
+	if (map_insert (shm, pml4, upage, page_cnt) == NULL)
+		goto fail;
+	lock_release (&shm_lock);
+	return addr;
+
+fail:
+	if (created) {
+		shm->name[0] = '\0';
+		shm_release (shm);
+	}
+	lock_release (&shm_lock);
+	return NULL;
+}
+
+/* Maps a new one-page segment without a name at ADDR in the
+   running process, for the kernel to share with it, and stores
+   the page's kernel virtual address in *KPAGE.  The segment stays
+   allocated, even once unmapped, until released with shm_put().
+   It is not shared with forked children.  Returns the segment, or
+   a null pointer on failure. */
+struct shm *
+shm_map_page (void *addr, void **kpage) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	uint8_t *upage = addr;
+	struct shm *shm = NULL;
+
+	if (pml4 == NULL || upage == NULL || pg_ofs (upage) != 0
+			|| !is_user_vaddr (upage))
+		return NULL;
+
+	lock_acquire (&shm_lock);
+	if (pml4_get_page (pml4, upage) == NULL) {
+		shm = shm_create ("", 1);
+		if (shm != NULL && map_insert (shm, pml4, upage, 1) == NULL) {
+			shm_release (shm);
+			shm = NULL;
+		}
+	}
+	if (shm != NULL) {
+		shm->hold_cnt++;
+		*kpage = shm->pages[0];
+	}
+	lock_release (&shm_lock);
+	return shm;
+}
+
+/* Drops the kernel's reference to SHM, taken by shm_map_page(). */
+void
+shm_put (struct shm *shm) {
+	lock_acquire (&shm_lock);
+	ASSERT (shm->hold_cnt > 0);
+	shm->hold_cnt--;
+	shm_release (shm);
+	lock_release (&shm_lock);
+}
+
+/* Unmaps the segment mapped at ADDR in the running process.
+   Returns false if no segment is mapped there. */
+bool
+shm_unmap (void *addr) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	struct shm_map *m;
+	bool found;
+
+	lock_acquire (&shm_lock);
+	m = map_find (pml4, addr);
+	found = m != NULL && m->addr == addr;
+	if (found) {
+		struct shm *shm = m->shm;
+		map_remove (m);
+		shm_release (shm);
+	}
+	lock_release (&shm_lock);
+	return found;
+}
+
+/* Removes the name of the segment called NAME.  Processes that
+   have it mapped keep it until they unmap it, but later calls to
+   shm_map() with NAME create a new segment.  Returns false if
+   there is no segment called NAME. */
+bool
+shm_unlink (const char *name) {
+	struct shm *shm;
+
+	lock_acquire (&shm_lock);
+	shm = shm_find (name);
+	if (shm != NULL) {
+		shm->name[0] = '\0';
+		shm_release (shm);
+	}
+	lock_release (&shm_lock);
+	return shm != NULL;
+}
+
+/* Returns true if VA lies in a segment mapped in PML4. */
+bool
+shm_mapped (uint64_t *pml4, const void *va) {
+	bool mapped;
+
+	lock_acquire (&shm_lock);
+	mapped = map_find (pml4, va) != NULL;
+	lock_release (&shm_lock);
+	return mapped;
+}
+
+/* Maps every segment mapped in PARENT into CHILD at the same
+   address, so that a forked child shares them with its parent.
+   Returns false if memory ran out. */
+bool
+shm_fork (uint64_t *child, uint64_t *parent) {
+	struct list_elem *e, *f;
+	bool success = true;
+
+	lock_acquire (&shm_lock);
+	for (e = list_begin (&segments); e != list_end (&segments);
+			e = list_next (e)) {
+		struct shm *shm = list_entry (e, struct shm, elem);
+
+		/* The kernel's segments belong to one process. */
+		if (shm->hold_cnt > 0)
+			continue;
+
+		/* New mappings go to the front, out of this walk's way. */
+		for (f = list_begin (&shm->maps); f != list_end (&shm->maps);
+				f = list_next (f)) {
+			struct shm_map *m = list_entry (f, struct shm_map, elem);
+			if (m->pml4 == parent && success)
+				success = map_insert (shm, child, m->addr, m->page_cnt) != NULL;
+		}
+	}
+	lock_release (&shm_lock);
+	return success;
+}
+
+/* Unmaps every segment mapped in PML4. */
+void
+shm_unmap_all (uint64_t *pml4) {
+	struct list_elem *e, *f;
+
+	lock_acquire (&shm_lock);
+	for (e = list_begin (&segments); e != list_end (&segments); ) {
+		struct shm *shm = list_entry (e, struct shm, elem);
+
+		e = list_next (e);
+		for (f = list_begin (&shm->maps); f != list_end (&shm->maps); ) {
+			struct shm_map *m = list_entry (f, struct shm_map, elem);
+
+			f = list_next (f);
+			if (m->pml4 == pml4)
+				map_remove (m);
+		}
+		shm_release (shm);
+	}
+	lock_release (&shm_lock);
+}
+
+/* Returns the linked segment called NAME, or a null pointer if
+   there is none. */
+static struct shm *
+shm_find (const char *name) {
+	struct list_elem *e;
+
+	if (name[0] == '\0')
+		return NULL;
+	for (e = list_begin (&segments); e != list_end (&segments);
+			e = list_next (e)) {
+		struct shm *shm = list_entry (e, struct shm, elem);
+		if (!strcmp (shm->name, name))
+			return shm;
+	}
+	return NULL;
+}
+
+/* Creates a segment called NAME of PAGE_CNT zeroed pages,
+   referenced by its name alone.  Returns a null pointer if memory
+   is not available. */
+static struct shm *
+shm_create (const char *name, size_t page_cnt) {
+	struct shm *shm = malloc (sizeof *shm);
+	size_t i;
+
+	if (shm == NULL)
+		return NULL;
+	shm->pages = calloc (page_cnt, sizeof *shm->pages);
+	if (shm->pages == NULL) {
+		free (shm);
+		return NULL;
+	}
+	strlcpy (shm->name, name, sizeof shm->name);
+	shm->page_cnt = page_cnt;
+	list_init (&shm->maps);
+	shm->hold_cnt = 0;
+	list_push_back (&segments, &shm->elem);
+
+	for (i = 0; i < page_cnt; i++) {
+		shm->pages[i] = palloc_get_page (PAL_USER | PAL_ZERO);
+		if (shm->pages[i] == NULL) {
+			shm->name[0] = '\0';
+			shm_release (shm);
+			return NULL;
+		}
+	}
+	return shm;
+}
+
+/* Returns the mapping in PML4 that covers VA, or a null pointer
+   if there is none. */
+static struct shm_map *
+map_find (uint64_t *pml4, const void *va) {
+	const uint8_t *p = va;
+	struct list_elem *e, *f;
+
+	for (e = list_begin (&segments); e != list_end (&segments);
+			e = list_next (e)) {
+		struct shm *shm = list_entry (e, struct shm, elem);
+
+		for (f = list_begin (&shm->maps); f != list_end (&shm->maps);
+				f = list_next (f)) {
+			struct shm_map *m = list_entry (f, struct shm_map, elem);
+			if (m->pml4 == pml4 && p >= m->addr
+					&& p < m->addr + m->page_cnt * PGSIZE)
+				return m;
+		}
+	}
+	return NULL;
+}
+
+/* Maps the first PAGE_CNT pages of SHM at ADDR in PML4 and
+   records the mapping.  Returns the mapping, or a null pointer if
+   memory is not available. */
+static struct shm_map *
+map_insert (struct shm *shm, uint64_t *pml4, uint8_t *addr,
+		size_t page_cnt) {
+	struct shm_map *m = malloc (sizeof *m);
+	size_t i;
+
+	if (m == NULL)
+		return NULL;
+	for (i = 0; i < page_cnt; i++)
+		if (!pml4_set_page (pml4, addr + i * PGSIZE, shm->pages[i], true)) {
+			while (i-- > 0)
+				pml4_clear_page (pml4, addr + i * PGSIZE);
+			free (m);
+			return NULL;
+		}
+
+	m->shm = shm;
+	m->pml4 = pml4;
+	m->addr = addr;
+	m->page_cnt = page_cnt;
+	list_push_front (&shm->maps, &m->elem);
+	return m;
+}
+
+/* Unmaps and frees M.  The caller must then call shm_release()
+   on M's segment, which M no longer holds. */
+static void
+map_remove (struct shm_map *m) {
+	size_t i;
+
+	for (i = 0; i < m->page_cnt; i++)
+		pml4_clear_page (m->pml4, m->addr + i * PGSIZE);
+	list_remove (&m->elem);
+	free (m);
+}
+
+/* Frees SHM and its pages if it has no name, mappings, or kernel
+   references left. */
+static void
+shm_release (struct shm *shm) {
+	size_t i;
+
+	if (shm->name[0] != '\0' || !list_empty (&shm->maps)
+			|| shm->hold_cnt > 0)
+		return;
+
+	for (i = 0; i < shm->page_cnt && shm->pages[i] != NULL; i++)
+		palloc_free_page (shm->pages[i]);
+	list_remove (&shm->elem);
+	free (shm->pages);
+	free (shm);
+}
@@ -1,16 +1,36 @@
 #include "userprog/syscall.h"
+#include <console.h>
+#include <debug.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/loader.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
+#include "devices/pmu.h"
+#include "userprog/aio.h"
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
+#include "userprog/process.h"
+#include "userprog/shm.h"
 #include "threads/flags.h"
 #include "intrinsic.h"
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
 
+static int sys_dmesg (void *, unsigned);
+static int sys_pmc_read (uint64_t *, unsigned);
+static bool futex_addr_ok (int *);
+static int sys_pipe (int *, int flags);
+static int64_t get_user (const uint8_t *);
+static void *sys_shm_map (const char *, void *, size_t);
+static bool sys_shm_unlink (const char *);
+static int sys_pipe_io (struct pipe_fd *, void *, unsigned, bool write,
+		bool flip);
+
 /* System call.
  *
  * Previously system call services was handled by the interrupt handler
@@ -35,12 +55,318 @@ syscall_init (void) {
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
+
+	futex_init ();
+	shm_init ();
+	aio_init ();
 }
 
 /* The main system call interface */
 void
-syscall_handler (struct intr_frame *f UNUSED) {
+syscall_handler (struct intr_frame *f) {
+	struct pipe_fd pfd;
+
+	/* Another thread may have ended the process. */
+	if (process_exiting ())
+		thread_exit ();
+
+	switch (f->R.rax) {
+		case SYS_DMESG:
+			f->R.rax = sys_dmesg ((void *) f->R.rdi, f->R.rsi);
+			return;
+		case SYS_PMC_READ:
+			f->R.rax = sys_pmc_read ((uint64_t *) f->R.rdi, f->R.rsi);
+			return;
+		case SYS_SBRK:
+			f->R.rax = (uint64_t) process_sbrk ((intptr_t) f->R.rdi);
+			return;
+		case SYS_FUTEX_WAIT:
+			f->R.rax = futex_addr_ok ((int *) f->R.rdi)
+				? futex_wait ((int *) f->R.rdi, f->R.rsi) : -1;
+			return;
+		case SYS_FUTEX_WAKE:
+			f->R.rax = futex_addr_ok ((int *) f->R.rdi)
+				? futex_wake ((int *) f->R.rdi, f->R.rsi) : -1;
+			return;
+		case SYS_THREAD_SPAWN:
+			f->R.rax = process_spawn ((void *) f->R.rdi, (void *) f->R.rsi,
+					(void *) f->R.rdx);
+			return;
+		case SYS_THREAD_JOIN:
+			f->R.rax = process_join (f->R.rdi);
+			return;
+		case SYS_THREAD_EXIT:
+			process_thread_exit (f->R.rdi);
+			NOT_REACHED ();
+		case SYS_PIPE:
+			f->R.rax = sys_pipe ((int *) f->R.rdi, f->R.rsi);
+			return;
+		case SYS_VMSPLICE:
+			f->R.rax = process_get_pipe (f->R.rdi, &pfd)
+				? sys_pipe_io (&pfd, (void *) f->R.rsi, f->R.rdx, pfd.writer, true)
+				: -1;
+			return;
+
+		/* Pipe descriptors; other descriptors fall through. */
+		case SYS_READ:
+		case SYS_WRITE:
+			if (process_get_pipe (f->R.rdi, &pfd)) {
+				f->R.rax = sys_pipe_io (&pfd, (void *) f->R.rsi, f->R.rdx,
+						f->R.rax == SYS_WRITE, false);
+				return;
+			}
+			break;
+		case SYS_CLOSE:
+			if (process_close_pipe (f->R.rdi))
+				return;
+			break;
+		case SYS_SHM_MAP:
+			f->R.rax = (uint64_t) sys_shm_map ((const char *) f->R.rdi,
+					(void *) f->R.rsi, f->R.rdx);
+			return;
+		case SYS_SHM_UNLINK:
+			f->R.rax = sys_shm_unlink ((const char *) f->R.rdi);
+			return;
+		case SYS_IO_SETUP:
+			f->R.rax = aio_setup ((void *) f->R.rdi, f->R.rsi);
+			return;
+		case SYS_IO_ENTER:
+			f->R.rax = aio_enter (f->R.rdi, f->R.rsi);
+			return;
+		case SYS_MUNMAP:
+			if (shm_unmap ((void *) f->R.rdi))
+				return;
+			break;
+	}
+
 	// TODO: Your implementation goes here.
 	printf ("system call!\n");
 	thread_exit ();
 }
+
+/* Returns true if the SIZE bytes at UADDR are mapped user memory
+   in the running process, and writable as well if WRITABLE. */
+bool
+user_buffer_ok (const void *uaddr, size_t size, bool writable) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	const uint8_t *p = pg_round_down (uaddr);
+	const uint8_t *end = (const uint8_t *) uaddr + size;
+
+	if (size == 0)
+		return true;
+	if (pml4 == NULL || end < (const uint8_t *) uaddr || !is_user_vaddr (end - 1))
+		return false;
+	for (; p < end; p += PGSIZE) {
+		uint64_t *pte = pml4e_walk (pml4, (uint64_t) p, 0);
+		if (pte == NULL || !(*pte & PTE_P) || !is_user_pte (pte)
+				|| (writable && !is_writable (pte)))
+			return false;
+	}
+	return true;
+}
+
+/* Most bytes dmesg() returns, the size of the kernel log. */
+#define DMESG_MAX (64 * 1024)
+
+/* Copies up to SIZE of the most recent bytes of the kernel log
+   into BUFFER.  The log is read into a kernel buffer first,
+   because it can only be read with interrupts off, where a fault
+   on BUFFER could not be survived.  Returns the number of bytes
+   copied, or -1 if BUFFER is not writable user memory or memory
+   is not available. */
+static int
+sys_dmesg (void *buffer, unsigned size) {
+	void *kbuf;
+	size_t n;
+	int result = -1;
+
+	if (!user_buffer_ok (buffer, size, true))
+		return -1;
+	if (size > DMESG_MAX)
+		size = DMESG_MAX;
+	kbuf = malloc (size > 0 ? size : 1);
+	if (kbuf == NULL)
+		return -1;
+	n = console_read_log (kbuf, size);
+	if (copy_to_user (buffer, kbuf, n))
+		result = n;
+	free (kbuf);
+	return result;
+}
+
+/* Stores up to CNT of the running thread's performance counts,
+   indexed by enum pmc_counter, into COUNTS.  Returns the number
+   of counters running (0 without a PMU), or -1 if COUNTS is not
+   writable user memory. */
+static int
+sys_pmc_read (uint64_t *counts, unsigned cnt) {
+	uint64_t now[PMC_CNT];
+
+	if (cnt > PMC_CNT)
+		cnt = PMC_CNT;
+	if (!user_buffer_ok (counts, cnt * sizeof *counts, true))
+		return -1;
+
+	pmu_read (now);
+	if (!copy_to_user (counts, now, cnt * sizeof *counts))
+		return -1;
+	return pmu_counters ();
+}
+
+/* Returns true if UADDR is an aligned int in writable user
+   memory of the running process, as a futex must be. */
+static bool
+futex_addr_ok (int *uaddr) {
+	return (uintptr_t) uaddr % sizeof *uaddr == 0
+		&& user_buffer_ok (uaddr, sizeof *uaddr, true);
+}
+
+/* Creates a pipe and stores its read and write descriptors in
+   FDS[0] and FDS[1].  FLAGS may include PIPE_NONBLOCK.  Returns 0
+   if successful, -1 on failure. */
+static int
+sys_pipe (int *fds, int flags) {
+	int kfds[2];
+
+	if (!user_buffer_ok (fds, sizeof kfds, true)
+			|| process_pipe (kfds, flags & PIPE_NONBLOCK) < 0)
+		return -1;
+	if (!copy_to_user (fds, kfds, sizeof kfds)) {
+		process_close_pipe (kfds[0]);
+		process_close_pipe (kfds[1]);
+		return -1;
+	}
+	return 0;
+}
+
+/* Reads SIZE bytes from the pipe end PFD into BUFFER, or writes
+   them from BUFFER if WRITE, moving whole pages if FLIP, and then
+   drops the reference to PFD that process_get_pipe() opened.
+   Returns the number of bytes transferred, or -1 on failure. */
+static int
+sys_pipe_io (struct pipe_fd *pfd, void *buffer, unsigned size, bool write,
+		bool flip) {
+	int result = -1;
+
+	if (write == pfd->writer && user_buffer_ok (buffer, size, !write)) {
+		if (write)
+			result = pipe_write (pfd->pipe, buffer, size, pfd->nonblock, flip);
+		else
+			result = pipe_read (pfd->pipe, buffer, size, pfd->nonblock, flip);
+	}
+	pipe_close (pfd->pipe, pfd->writer);
+	return result;
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, a buffer of SIZE bytes.  Returns false if the string is
+   not in mapped user memory or does not fit. */
+bool
+copy_in_string (char *dst, const char *usrc, size_t size) {
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		int64_t c;
+
+		if ((i == 0 || pg_ofs (usrc + i) == 0)
+				&& !user_buffer_ok (usrc + i, 1, false))
+			return false;
+		c = get_user ((const uint8_t *) usrc + i);
+		if (c == -1)
+			return false;
+		dst[i] = c;
+		if (dst[i] == '\0')
+			return true;
+	}
+	return false;
+}
+
+/* Maps SIZE bytes of the shared memory segment called NAME at
+   ADDR, creating the segment if need be.  Returns ADDR, or a null
+   pointer on failure. */
+static void *
+sys_shm_map (const char *name, void *addr, size_t size) {
+	char kname[SHM_NAME_MAX + 1];
+
+	if (!copy_in_string (kname, name, sizeof kname))
+		return NULL;
+	return shm_map (kname, addr, size);
+}
+
+/* Removes the name of the shared memory segment called NAME.
+   Returns false if there is no such segment. */
+static bool
+sys_shm_unlink (const char *name) {
+	char kname[SHM_NAME_MAX + 1];
+
+	return copy_in_string (kname, name, sizeof kname) && shm_unlink (kname);
+}
+
+/* Returns the byte at user address UADDR, or -1 if reading it
+   page-faults.  page_fault() resumes a fault at get_user_load at
+   the address in rax, with rax set to -1.  Kept out of line so
+   that the label is defined once. */
+static __attribute__ ((noinline, noclone)) int64_t
+get_user (const uint8_t *uaddr) {
+	int64_t result;
+	__asm __volatile (
+			"movabsq $1f, %0\n"
+			".globl get_user_load\n"
+			"get_user_load:\n"
+			"movzbq %1, %0\n"
+			"1:\n"
+			: "=&a" (result) : "m" (*uaddr));
+	return result;
+}
+
+/* Writes BYTE to user address UDST.  Returns false if the write
+   page-faults, the same way as get_user(). */
+static __attribute__ ((noinline, noclone)) bool
+put_user (uint8_t *udst, uint8_t byte) {
+	int64_t error;
+	__asm __volatile (
+			"movabsq $1f, %0\n"
+			".globl put_user_store\n"
+			"put_user_store:\n"
+			"movb %b2, %1\n"
+			"1:\n"
+			: "=&a" (error), "=m" (*udst) : "q" (byte));
+	return error != -1;
+}
+
+/* Copies SIZE bytes from user address USRC to DST.  Returns false
+   if USRC is not mapped user memory, even if it is unmapped while
+   the copy is under way. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size) {
+	const uint8_t *src = usrc;
+	uint8_t *d = dst;
+	size_t i;
+
+	if (!user_buffer_ok (usrc, size, false))
+		return false;
+	for (i = 0; i < size; i++) {
+		int64_t byte = get_user (src + i);
+		if (byte == -1)
+			return false;
+		d[i] = byte;
+	}
+	return true;
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns false
+   if UDST is not writable user memory, even if it is unmapped
+   while the copy is under way. */
+bool
+copy_to_user (void *udst, const void *src, size_t size) {
+	const uint8_t *s = src;
+	uint8_t *dst = udst;
+	size_t i;
+
+	if (!user_buffer_ok (udst, size, true))
+		return false;
+	for (i = 0; i < size; i++)
+		if (!put_user (dst + i, s[i]))
+			return false;
+	return true;
+}
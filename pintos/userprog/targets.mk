@@ -4,3 +4,7 @@ userprog_SRC += userprog/syscall-entry.S # System call entry.
 userprog_SRC += userprog/syscall.c	# System call handler.
 userprog_SRC += userprog/gdt.c		# GDT initialization.
 userprog_SRC += userprog/tss.c		# TSS management.
+userprog_SRC += userprog/futex.c	# Fast user-space mutexes.
+userprog_SRC += userprog/pipe.c		# Pipes.
+userprog_SRC += userprog/shm.c		# Shared memory segments.
+userprog_SRC += userprog/aio.c		# Asynchronous I/O rings.